@@ -2,8 +2,10 @@
 #include <vector>
 #include <fstream>
 
-#if defined(USEV2)
-#include "astarv2.hpp"
+#if defined(USEJPS)
+#include "jps.hpp"
+#elif defined(USEV2)
+#include "tiled.hpp"
 #else
 #include "astar.hpp"
 #endif
@@ -48,8 +50,77 @@ void Print(std::vector<std::string> &map)
     }
 }
 
+// Helper function to print path (or that there is none)
+void Print(AStar::Path &path, const char src, const char dst)
+{
+    // If path is found, the first and last elements of path.Points are the src and dst coordinates
+    if (path.Points.size() > 0)
+    {
+        std::cout << std::endl
+                  << "Path from " << src << " to " << dst << " (X, Y) required " << path.Points.size() - 1 << " step";
+
+        if (path.Points.size() > 2)
+        {
+            std::cout << "s";
+        }
+
+        std::cout << ":" << std::endl;
+
+        Print(path.Points);
+    }
+    else
+    {
+        std::cout << std::endl
+                  << "No path found!" << std::endl;
+    }
+}
+
 int main(int argc, char **argv)
 {
+    const char src = 'A';
+    const char dst = 'B';
+    const char passable = ' ';
+    const char mark = '*';
+
+#if defined(USEV2) || defined(USEJPS)
+    // Binary maps (see convert.cpp) are mapped into memory and searched as they are, without printing them
+    auto grid = AStar::Grid();
+
+    if (argc > 1 && grid.Load(argv[1]))
+    {
+        auto context = AStar::SearchContext();
+
+#if defined(USEJPS)
+        auto &path = AStar::JPS::FindPath(grid, src, dst, context);
+#else
+        auto &path = AStar::FindPath(grid, src, dst, context);
+#endif
+
+        Print(path, src, dst);
+
+        return 0;
+    }
+#endif
+
+#if defined(USEV2)
+    // Maps too large for memory (see convert.cpp) are read a chunk at a time as the search reaches them
+    auto store = AStar::Tiled::Store();
+
+    if (argc > 1 && store.Open(argv[1]))
+    {
+        auto context = AStar::Tiled::SearchContext();
+
+        auto &path = AStar::FindPath(store, src, dst, context);
+
+        Print(path, src, dst);
+
+        std::cout << std::endl
+                  << "Chunks read: " << store.Misses << ", found in memory: " << store.Hits << std::endl;
+
+        return 0;
+    }
+#endif
+
     auto map = std::vector<std::string>();
 
     if (argc > 1)
@@ -82,40 +153,24 @@ int main(int argc, char **argv)
     // Print initial map without path
     Print(map);
 
-    const char src = 'A';
-    const char dst = 'B';
-    const char passable = ' ';
-    const char mark = '*';
-
+#if defined(USEJPS)
+    // Find path from src to dst using Jump Point Search
+    auto path = AStar::JPS::FindPath(map, src, dst, passable);
+#else
     // Find path from src to dst using A*
     auto path = AStar::FindPath(map, src, dst, passable);
+#endif
+
+    Print(path, src, dst);
 
-    // If path is found, the first and last elements of path.Points are the src and dst coordinates
     if (path.Points.size() > 0)
     {
-        std::cout << std::endl
-                  << "Path from " << src << " to " << dst << " (X, Y) required " << path.Points.size() - 1 << " step";
-
-        if (path.Points.size() > 2)
-        {
-            std::cout << "s";
-        }
-
-        std::cout << ":" << std::endl;
-
-        Print(path.Points);
-
         std::cout << std::endl
                   << "Map:" << std::endl;
 
-        path.Mark(mark);
+        path.Mark(map, mark);
 
-        Print(path.Map);
-    }
-    else
-    {
-        std::cout << std::endl
-                  << "No path found!" << std::endl;
+        Print(map);
     }
 
     return 0;
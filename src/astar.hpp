@@ -61,6 +61,15 @@ namespace AStar
                 Map[tile.Y][tile.X] = c;
             }
         }
+
+        // Helper function to mark path on another map
+        void Mark(std::vector<std::string> &map, const char c)
+        {
+            for (auto i = 1; i + 1 < (int)Points.size(); i++)
+            {
+                map[Points[i].Y][Points[i].X] = c;
+            }
+        }
     };
 
     // Class representing a node in the graph
@@ -2,27 +2,22 @@
 #define __ASTAR_HPP__
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
-#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "grid.hpp"
+
 // A C++ version of A* pathfinding algorithm from https://dotnetcoretutorials.com/2020/07/25/a-search-pathfinding-algorithm-in-c/
 // Most of the comments from the original version are preserved and/or have minor modifications.
 //
-// This version uses smart pointers
+// This version keeps the nodes of the graph in flat arrays (see SearchContext class below) instead of
+// allocating them one by one, so nothing is left for smart pointers to clean up.
 namespace AStar
 {
-    template <typename T>
-    using Smart = std::shared_ptr<T>;
-
-    template <typename T, typename R = typename std::vector<T>::const_iterator>
-    R Find(std::vector<T> &vector, T &key, bool F(T &, T &))
-    {
-        return std::find_if(vector.begin(), vector.end(), [&](T &f)
-                            { return F(key, f); });
-    }
-
     // Cartesian coordinates (see Path class below)
     class Point
     {
@@ -44,253 +39,1350 @@ namespace AStar
     };
 
     // Path found by A* algorithm
+    //
+    // Only the coordinates are kept. To draw the path, mark it on (a copy of) the map.
     class Path
     {
     public:
         // List of coordinates of the path
         std::vector<AStar::Point> Points;
 
-        // String representation of the environment
-        std::vector<std::string> Map;
-
         Path()
         {
         }
 
-        // Helper function to mark path on map
-        void Mark(const char c)
+        // Helper function to mark path (excluding src and dst) on map
+        void Mark(std::vector<std::string> &map, const char c)
         {
-            for (auto point = std::next(Points.begin()); point != --Points.end(); point++)
+            for (auto i = 1; i + 1 < (int)Points.size(); i++)
             {
-                auto tile = *point;
+                auto &tile = Points[i];
 
-                Map[tile.Y][tile.X] = c;
+                map[tile.Y][tile.X] = c;
             }
         }
     };
 
-    // Class representing a node in the graph
-    class Node
+    // Nodes are identified by the position of their tile on the map (see Grid::Index)
+    const std::uint32_t None = UINT32_MAX;
+
+    // On 8-connected grids, costs are fixed-point: a straight step costs 10 and a diagonal step
+    // costs 14 (~ 10 * sqrt(2)) so that costs and distances remain exact integers.
+    // On 4-connected grids, each step costs 1.
+    const int Straight = 10;
+
+    const int Diagonal = 14;
+
+    // Rules for moving diagonally past obstacles on 8-connected grids
+    enum class Corners
+    {
+        // Diagonal moves are always allowed
+        Cut,
+
+        // Diagonal moves are allowed if at least one of the two tiles next to the move is passable
+        Skirt,
+
+        // Diagonal moves are allowed only if both tiles next to the move are passable
+        Avoid
+    };
+
+    // Open list of a search
+    enum class Queue
+    {
+        // Binary heap (see Heap), for any costs and heuristic
+        Heap,
+
+        // Bucket queue (see Buckets), faster while costs and estimates are small whole numbers, as on grids
+        Buckets
+    };
+
+    // The distance is essentially the estimated distance, ignoring obstacles to our target.
+    // So how many nodes left and right, up and down, ignoring obstacles, to get there.
+    //
+    // Computes the 2D Manhattan Distance (4-connected) or the Octile Distance (8-connected),
+    // which is also the exact cost of moving along a straight or diagonal line between the tiles.
+    template <int Connectivity = 4>
+    int Distance(int x, int y, int X, int Y)
+    {
+        auto dx = std::abs(X - x);
+
+        auto dy = std::abs(Y - y);
+
+        if (Connectivity == 8)
+        {
+            return AStar::Straight * std::abs(dx - dy) + AStar::Diagonal * std::min(dx, dy);
+        }
+
+        return dx + dy;
+    }
+
+    // Estimate of the cost of reaching dst from a tile that never overestimates it: the Distance between
+    // them, scaled by the lowest weight on the grid (or any map with the same tiles, see Tiled::Store)
+    template <int Connectivity = 4>
+    class Heuristic
     {
     public:
+        template <typename M>
+        Heuristic(M &grid, int dst)
+        {
+            X = grid.X(dst);
+
+            Y = grid.Y(dst);
+
+            Minimum = grid.IsWeighted() ? grid.MinimumWeight : 1;
+        }
+
+        // Estimate for the tile at (x, y)
+        int operator()(int, int x, int y)
+        {
+            return AStar::Distance<Connectivity>(x, y, X, Y) * Minimum;
+        }
+
+    private:
         int X;
 
         int Y;
 
-        int Cost;
+        int Minimum;
+    };
 
-        int Distance;
+    // Parts of a search timed by Stats: setting up the buffers, the search itself and following the
+    // parents back to src
+    enum class Phase
+    {
+        Setup,
+        Search,
+        Path
+    };
 
-        Smart<AStar::Node> Parent = nullptr;
+    // Statistics policy of Search that records nothing. Every call is empty, so searches without
+    // statistics compile to the same code as if they were not there.
+    class NoStats
+    {
+    public:
+        void Start()
+        {
+        }
 
-        Node()
+        void Enter(AStar::Phase)
         {
         }
 
-        Node(int x, int y, int cost, Smart<AStar::Node> &parent)
+        void Stop()
         {
-            X = x;
+        }
 
-            Y = y;
+        void Expand(int, int, int, int)
+        {
+        }
 
-            Cost = cost;
+        void Generate()
+        {
+        }
 
-            Parent = parent;
+        void Reopen()
+        {
         }
 
-        // Total cost to traverse this node
-        int CostDistance()
+        void Estimate()
         {
-            return (Cost + Distance);
         }
 
-        // The distance is essentially the estimated distance, ignoring obstacles to our target.
-        // So how many nodes left and right, up and down, ignoring obstacles, to get there.
-        //
-        // Computes the 2D Manhattan Distance
-        void SetDistance(Smart<AStar::Node> &node)
+        void Open(int)
         {
-            Distance = std::abs(node->X - X) + std::abs(node->Y - Y);
         }
     };
 
-    typedef std::vector<Smart<AStar::Node>> Moves;
-
-    bool IsPassable(std::vector<std::string> &map, int X, int Y, int mapX, int mapY, const char dst, const char passable)
+    // Statistics policy of Search that records what the search did, e.g. to find out why some queries
+    // take much longer than others. Filled in anew by every search it is passed to.
+    class Stats
     {
-        return (X >= 0 && X <= mapX && Y >= 0 && Y <= mapY && (map[Y][X] == passable || map[Y][X] == dst));
-    }
+    public:
+        // Tiles taken off the open list and expanded
+        long long Expanded = 0;
 
-    // Get all traversible nodes from current node
-    Moves Nodes(std::vector<std::string> &map, Smart<AStar::Node> &current, Smart<AStar::Node> &target, const char dst, const char passable)
-    {
-        // Define neighbors (X, Y): Up, Down, Left, Right
-        std::vector<std::pair<int, int>> neighbors = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+        // Tiles put on the open list for the first time
+        long long Generated = 0;
+
+        // Tiles on the open list reached again by a cheaper route (their key was lowered)
+        long long Reopened = 0;
+
+        // Calls to the heuristic
+        long long Estimates = 0;
+
+        // Largest number of tiles on the open list at once
+        int OpenPeak = 0;
 
-        auto traversable = Moves();
+        // Seconds spent in each Phase
+        double Times[3] = {};
 
-        if (!map.empty())
+        // Tile expanded, with its cost from src (g) and estimate of the cost to dst (h) when it was expanded
+        struct Step
         {
-            auto mapX = map.front().length() - 1;
+            std::int32_t X;
 
-            auto mapY = map.size() - 1;
+            std::int32_t Y;
 
-            for (auto &neighbor : neighbors)
-            {
-                auto index = 0;
+            std::int32_t Cost;
 
-                // Check if within map boundaries and if passable and/or leads to destination
-                if (AStar::IsPassable(map, current->X + neighbor.first, current->Y + neighbor.second, mapX, mapY, dst, passable))
-                {
-                    traversable.push_back(std::make_shared<AStar::Node>(current->X + neighbor.first, current->Y + neighbor.second, current->Cost + 1, current));
+            std::int32_t Estimate;
+        };
 
-                    traversable[index]->SetDistance(target);
+        // Record every tile expanded in Steps (see Trace)
+        bool Tracing = false;
 
-                    index++;
-                }
+        // Tiles expanded, in the order they were expanded (if Tracing)
+        std::vector<AStar::Stats::Step> Steps;
+
+        void Start()
+        {
+            Expanded = 0;
+
+            Generated = 0;
+
+            Reopened = 0;
+
+            Estimates = 0;
+
+            OpenPeak = 0;
+
+            std::fill(std::begin(Times), std::end(Times), 0);
+
+            Steps.clear();
+
+            Current = -1;
+
+            Enter(AStar::Phase::Setup);
+        }
+
+        // Start timing another phase (the time since the last call goes to the phase it started)
+        void Enter(AStar::Phase phase)
+        {
+            Close();
+
+            Current = (int)phase;
+        }
+
+        void Stop()
+        {
+            Close();
+
+            Current = -1;
+        }
+
+        // Tile at (x, y) expanded with the given cost from src and estimate of the cost to dst
+        void Expand(int x, int y, int cost, int estimate)
+        {
+            Expanded++;
+
+            if (Tracing)
+            {
+                Steps.push_back({x, y, cost, estimate});
             }
         }
 
-        return traversable;
-    }
+        void Generate()
+        {
+            Generated++;
+        }
 
-    bool Compare(Smart<AStar::Node> &a, Smart<AStar::Node> &b)
-    {
-        return a->X == b->X && a->Y == b->Y;
-    }
+        void Reopen()
+        {
+            Reopened++;
+        }
 
-    // Get index of node from a list
-    Moves::const_iterator Find(Moves &nodes, Smart<AStar::Node> &node)
-    {
-        return AStar::Find(nodes, node, Compare);
-    }
+        void Estimate()
+        {
+            Estimates++;
+        }
 
-    // Remove node from list
-    void Remove(Moves &nodes, Smart<AStar::Node> &node)
-    {
-        auto found = AStar::Find(nodes, node);
+        // Number of tiles on the open list after a tile was put on it
+        void Open(int size)
+        {
+            OpenPeak = std::max(OpenPeak, size);
+        }
 
-        if (found != nodes.end())
+        // Seconds spent in all phases
+        double Time()
         {
-            nodes.erase(found);
+            return Times[0] + Times[1] + Times[2];
         }
-    }
 
-    // Check if node is on the list
-    bool Is(Moves &nodes, Smart<AStar::Node> &node)
+    private:
+        // Phase being timed (-1 if none) and when it started
+        int Current = -1;
+
+        std::chrono::steady_clock::time_point Since;
+
+        void Close()
+        {
+            auto now = std::chrono::steady_clock::now();
+
+            if (Current >= 0)
+            {
+                Times[Current] += std::chrono::duration<double>(now - Since).count();
+            }
+
+            Since = now;
+        }
+    };
+
+    // Storage of the per-tile state of a search (see BasicSearchContext): arrays with an element for every
+    // tile of the map, kept from one search to the next
+    class Dense
     {
-        return AStar::Find(nodes, node) != nodes.end();
-    }
+    public:
+        template <typename T>
+        using Array = std::vector<T>;
+
+        // Let go of what the last search stored (nothing to do, the arrays are reused as they are)
+        template <typename T>
+        static void Recycle(std::vector<T> &)
+        {
+        }
+    };
 
-    // Get coordinates of an object on the map
-    void Coordinates(std::vector<std::string> &map, const char c, Smart<AStar::Node> &node)
+    // Indexed binary heap (min-heap) used as the open list.
+    //
+    // Each entry is identified by the index of its tile on the map so that we can locate it in O(1)
+    // and lower its key (decrease-key) when a cheaper route to the tile is found.
+    //
+    // Keys are compared with <, so anything ordered can be used (e.g. a pair compared lexicographically).
+    // The position of each tile is kept in Storage (see Dense).
+    template <typename Priority = int, typename Storage = AStar::Dense>
+    class Heap
     {
-        for (auto i = 0; i < map.size(); i++)
+    public:
+        Heap()
         {
-            auto result = map[i].find(c);
+        }
 
-            if (result >= 0 && result < map[i].length())
-            {
-                node->X = result;
+        bool Empty()
+        {
+            return Entries.empty();
+        }
 
-                node->Y = i;
+        int Size()
+        {
+            return Entries.size();
+        }
 
-                break;
+        // Make room for a map with the given number of tiles and empty the heap
+        void Reset(int size)
+        {
+            if (size > (int)Slots.size())
+            {
+                Slots.resize(size);
             }
+
+            Storage::Recycle(Slots);
+
+            Entries.clear();
         }
-    }
 
-    // Find path from src to dst using the A* algorithm
-    AStar::Path FindPath(std::vector<std::string> &map, const char src, const char dst, const char passable)
-    {
-        auto path = AStar::Path();
+        // Mark tile as not on the heap (Slots are not cleared between searches, see SearchContext)
+        void Forget(int id)
+        {
+            Slots[id] = -1;
+        }
+
+        // Check if tile is on the heap
+        bool Contains(int id)
+        {
+            return Slots[id] >= 0;
+        }
+
+        // Tile with the lowest key
+        int Top()
+        {
+            return Entries.front().Id;
+        }
+
+        // Key of a tile currently on the heap
+        Priority Key(int id)
+        {
+            return Entries[Slots[id]].Key;
+        }
+
+        // Add tile to the heap
+        void Push(int id, Priority key)
+        {
+            Entries.push_back({key, id});
+
+            Slots[id] = Entries.size() - 1;
+
+            Up(Entries.size() - 1);
+        }
 
-        if (!map.empty())
+        // Lower the key of a tile already on the heap
+        void Decrease(int id, Priority key)
         {
-            auto start = std::make_shared<AStar::Node>();
+            auto slot = Slots[id];
 
-            AStar::Coordinates(map, src, start);
+            Entries[slot].Key = key;
 
-            auto end = std::make_shared<AStar::Node>();
+            Up(slot);
+        }
+
+        // Same as Push and Decrease above, for searches that also give the cost of the tile so far (see
+        // Buckets): the heap does not break ties by cost
+        void Push(int id, Priority key, int)
+        {
+            Push(id, key);
+        }
+
+        void Decrease(int id, Priority key, int)
+        {
+            Decrease(id, key);
+        }
+
+        // Change the key of a tile already on the heap
+        void Update(int id, Priority key)
+        {
+            auto slot = Slots[id];
+
+            Entries[slot].Key = key;
 
-            AStar::Coordinates(map, dst, end);
+            Up(slot);
+
+            Down(Slots[id]);
+        }
 
-            start->SetDistance(end);
+        // Remove a tile from the heap
+        void Remove(int id)
+        {
+            auto slot = Slots[id];
 
-            // List of nodes to be checked
-            auto active = Moves();
+            auto last = Entries.back();
 
-            // List of nodes already visited
-            auto visited = Moves();
+            Entries.pop_back();
 
-            active.push_back(start);
+            Slots[id] = -1;
 
-            while (!active.empty())
+            if (slot < (int)Entries.size())
             {
-                // Sort based on CostDistance
-                std::sort(active.begin(), active.end(), [](Smart<AStar::Node> &src, Smart<AStar::Node> &dst)
-                          { return src->CostDistance() < dst->CostDistance(); });
+                Entries[slot] = last;
 
-                auto check = active.front();
+                Slots[last.Id] = slot;
 
-                if (check->X == end->X && check->Y == end->Y)
-                {
-                    // We found the destination and we can be sure (because of the sort order above)
-                    // that it's the most low cost option.
-                    auto node = check;
+                Up(slot);
+
+                Down(Slots[last.Id]);
+            }
+        }
 
-                    // Copy map
-                    path.Map = map;
+        // Remove the tile with the lowest key from the heap and return its index
+        int Pop()
+        {
+            auto top = Entries.front().Id;
 
-                    while (node)
-                    {
-                        path.Points.push_back(AStar::Point(node->X, node->Y));
+            Slots[top] = -1;
 
-                        node = node->Parent;
-                    }
+            auto last = Entries.back();
 
-                    // Reverse list of coordinates so path leads from src to dst
-                    std::reverse(path.Points.begin(), path.Points.end());
+            Entries.pop_back();
 
-                    return path;
-                }
+            if (!Entries.empty())
+            {
+                Entries[0] = last;
+
+                Slots[last.Id] = 0;
+
+                Down(0);
+            }
+
+            return top;
+        }
+
+    private:
+        struct Entry
+        {
+            Priority Key;
+
+            int Id;
+        };
+
+        // Heap storage
+        std::vector<Entry> Entries;
 
-                visited.push_back(check);
+        // Position of each tile in Entries (-1 if not on the heap)
+        typename Storage::template Array<int> Slots;
 
-                AStar::Remove(active, check);
+        void Up(int slot)
+        {
+            auto entry = Entries[slot];
 
-                auto nodes = AStar::Nodes(map, check, end, dst, passable);
+            while (slot > 0)
+            {
+                auto parent = (slot - 1) / 2;
 
-                for (auto &node : nodes)
+                if (!(entry.Key < Entries[parent].Key))
                 {
-                    // We have already visited this node so we don't need to do so again!
-                    if (AStar::Is(visited, node))
-                    {
-                        continue;
-                    }
+                    break;
+                }
 
-                    // It's already in the active list, but that's OK, maybe this new node has a better value (e.g. We might zigzag earlier but this is now straighter).
-                    if (AStar::Is(active, node))
-                    {
-                        auto existing = *AStar::Find(active, node);
+                Entries[slot] = Entries[parent];
 
-                        if (existing->CostDistance() > node->CostDistance())
-                        {
-                            AStar::Remove(active, existing);
+                Slots[Entries[slot].Id] = slot;
 
-                            active.push_back(node);
-                        }
-                    }
-                    else
-                    {
-                        // We've never seen this node before so add it to the list.
-                        active.push_back(node);
-                    }
+                slot = parent;
+            }
+
+            Entries[slot] = entry;
+
+            Slots[entry.Id] = slot;
+        }
+
+        void Down(int slot)
+        {
+            auto entry = Entries[slot];
+
+            auto size = (int)Entries.size();
+
+            while (true)
+            {
+                auto child = slot * 2 + 1;
+
+                if (child >= size)
+                {
+                    break;
+                }
+
+                if (child + 1 < size && Entries[child + 1].Key < Entries[child].Key)
+                {
+                    child++;
+                }
+
+                if (!(Entries[child].Key < entry.Key))
+                {
+                    break;
                 }
+
+                Entries[slot] = Entries[child];
+
+                Slots[Entries[slot].Id] = slot;
+
+                slot = child;
             }
+
+            Entries[slot] = entry;
+
+            Slots[entry.Id] = slot;
         }
+    };
 
-        return path;
+    // Bucket queue (as in Dial's algorithm) used as the open list when keys are small whole numbers, as
+    // costs and estimates are on grids: a list of tiles for every key, so adding a tile and lowering its
+    // key take O(1) and taking the tile with the lowest key only skips over the lists left empty below it.
+    //
+    // The lists are a ring indexed by key modulo its size, which only grows to the span between the lowest
+    // and highest keys waiting at once, not to the highest key. With a consistent heuristic that span is at
+    // most twice the costliest step (a step can raise the estimate by no more than its cost), so memory
+    // stays the same on large weighted maps, where keys run into the millions.
+    //
+    // Tiles with the same key come off highest cost first (and so lowest estimate), so ties go to the tiles
+    // closest to dst and fewer tiles are expanded where many paths are as short. The list of the lowest key
+    // is sorted by cost when it is reached; with a consistent heuristic, every tile added to it after that
+    // costs more than the tiles left in it (it comes from expanding the one that cost most), so it stays
+    // sorted as tiles are added on top. Otherwise it is sorted again. Keys and costs must not be negative.
+    template <typename Storage = AStar::Dense>
+    class Buckets
+    {
+    public:
+        Buckets()
+        {
+        }
+
+        bool Empty()
+        {
+            return Count == 0;
+        }
+
+        int Size()
+        {
+            return Count;
+        }
+
+        // Make room for a map with the given number of tiles and empty the queue
+        void Reset(int size)
+        {
+            if (size > (int)Slots.size())
+            {
+                Slots.resize(size);
+
+                Keys.resize(size);
+            }
+
+            Storage::Recycle(Slots);
+
+            Storage::Recycle(Keys);
+
+            // Only the lists from the lowest key to the highest can still hold tiles
+            for (auto key = Lowest; key <= Highest; key++)
+            {
+                Lists[key & Mask].clear();
+            }
+
+            Count = 0;
+
+            Lowest = 0;
+
+            Highest = -1;
+
+            Sorted = -1;
+        }
+
+        // Tile with the lowest key (the one that costs most of those)
+        int Top()
+        {
+            while (Lists[Lowest & Mask].empty())
+            {
+                Lowest++;
+            }
+
+            if (Sorted != Lowest)
+            {
+                Sort(Lowest);
+            }
+
+            return (std::uint32_t)Lists[Lowest & Mask].back();
+        }
+
+        // Key of a tile currently in the queue
+        int Key(int id)
+        {
+            return Keys[id];
+        }
+
+        // Add tile to the queue, given what it costs so far
+        void Push(int id, int key, int cost)
+        {
+            auto lowest = Count == 0 ? key : std::min(Lowest, key);
+
+            auto highest = Count == 0 ? key : std::max(Highest, key);
+
+            if (highest - lowest >= (int)Lists.size())
+            {
+                Grow(highest - lowest + 1);
+            }
+
+            Lowest = lowest;
+
+            Highest = highest;
+
+            auto &list = Lists[key & Mask];
+
+            auto entry = (std::uint64_t)cost << 32 | (std::uint32_t)id;
+
+            if (key == Sorted && !list.empty() && cost < (int)(list.back() >> 32))
+            {
+                Sorted = -1;
+            }
+
+            Slots[id] = list.size();
+
+            Keys[id] = key;
+
+            list.push_back(entry);
+
+            Count++;
+        }
+
+        // Lower the key of a tile already in the queue, given what it now costs
+        void Decrease(int id, int key, int cost)
+        {
+            // The last tile of its list takes its place
+            auto &list = Lists[Keys[id] & Mask];
+
+            auto last = list.back();
+
+            if (Keys[id] == Sorted && (int)(std::uint32_t)last != id)
+            {
+                Sorted = -1;
+            }
+
+            list[Slots[id]] = last;
+
+            Slots[(std::uint32_t)last] = Slots[id];
+
+            list.pop_back();
+
+            Count--;
+
+            Push(id, key, cost);
+        }
+
+        // Remove the tile with the lowest key from the queue and return its index
+        int Pop()
+        {
+            auto top = Top();
+
+            Lists[Lowest & Mask].pop_back();
+
+            Count--;
+
+            return top;
+        }
+
+    private:
+        // Tiles by key (in Lists[key & Mask]), each with its cost in the upper 32 bits
+        std::vector<std::vector<std::uint64_t>> Lists;
+
+        int Mask = 0;
+
+        // Position of each tile in its list, and its key
+        typename Storage::template Array<int> Slots;
+
+        typename Storage::template Array<int> Keys;
+
+        int Count = 0;
+
+        // No list below Lowest or above Highest holds a tile
+        int Lowest = 0;
+
+        int Highest = -1;
+
+        // Key of the list sorted by cost, the highest last (-1 if none)
+        int Sorted = -1;
+
+        // Lists being sorted by Sort, and how many of their tiles have each cost
+        std::vector<std::uint64_t> Buffer;
+
+        std::vector<int> Counts;
+
+        // Make the ring hold at least span keys, moving the lists of the keys waiting to their new places
+        void Grow(int span)
+        {
+            auto size = std::max((int)Lists.size(), 64);
+
+            while (size < span)
+            {
+                size *= 2;
+            }
+
+            auto lists = std::vector<std::vector<std::uint64_t>>(size);
+
+            if (Count > 0)
+            {
+                for (auto key = Lowest; key <= Highest; key++)
+                {
+                    lists[key & (size - 1)].swap(Lists[key & Mask]);
+                }
+            }
+
+            Lists.swap(lists);
+
+            Mask = size - 1;
+        }
+
+        // Sort a list by cost: short lists by insertion, others by counting (costs waiting in one list span
+        // no more than the estimates of their tiles). Tiles that cost the same keep the order they were added
+        // in, whatever their indices.
+        void Sort(int key)
+        {
+            auto &list = Lists[key & Mask];
+
+            if (list.size() <= 16)
+            {
+                for (auto i = 1; i < (int)list.size(); i++)
+                {
+                    auto entry = list[i];
+
+                    auto j = i;
+
+                    for (; j > 0 && list[j - 1] >> 32 > entry >> 32; j--)
+                    {
+                        list[j] = list[j - 1];
+                    }
+
+                    list[j] = entry;
+                }
+            }
+            else
+            {
+                Tally(list);
+            }
+
+            for (auto i = 0; i < (int)list.size(); i++)
+            {
+                Slots[(std::uint32_t)list[i]] = i;
+            }
+
+            Sorted = key;
+        }
+
+        void Tally(std::vector<std::uint64_t> &list)
+        {
+            auto lowest = list.front() >> 32;
+
+            auto highest = lowest;
+
+            for (auto entry : list)
+            {
+                lowest = std::min(lowest, entry >> 32);
+
+                highest = std::max(highest, entry >> 32);
+            }
+
+            // Costs spread much wider than the list (as on weighted maps) would make the tally larger than it
+            if (highest - lowest > list.size() * 4)
+            {
+                std::stable_sort(list.begin(), list.end(), [](std::uint64_t a, std::uint64_t b) { return a >> 32 < b >> 32; });
+
+                return;
+            }
+
+            Counts.assign(highest - lowest + 2, 0);
+
+            for (auto entry : list)
+            {
+                Counts[(entry >> 32) - lowest + 1]++;
+            }
+
+            for (auto i = 1; i < (int)Counts.size(); i++)
+            {
+                Counts[i] += Counts[i - 1];
+            }
+
+            Buffer.resize(list.size());
+
+            for (auto entry : list)
+            {
+                Buffer[Counts[(entry >> 32) - lowest]++] = entry;
+            }
+
+            list.swap(Buffer);
+        }
+    };
+
+    // Scratch buffers used by a search: the open list, the per-tile search state and the path found.
+    //
+    // Per-tile state is kept in flat arrays indexed by tile (see Grid::Index). This is also where the
+    // nodes of the graph live: a node is simply its tile's cost and the 32-bit index of its parent's
+    // tile, so no memory is allocated per node during a search.
+    //
+    // Entries are only valid for tiles stamped with the current generation. Starting a new search
+    // simply bumps the generation, so a context can be reused by the next search without clearing it.
+    // Buffers only ever grow, so once a context has seen the largest map (and the longest path) it is
+    // used with, searches no longer allocate memory.
+    //
+    // The arrays are those of Storage: Dense for a Grid, or only the parts of the map a search reaches
+    // for maps too large to keep in memory (see Tiled::Sparse).
+    template <typename Storage>
+    class BasicSearchContext
+    {
+    public:
+        // List of nodes to be checked
+        AStar::Heap<int, Storage> Open;
+
+        // List of nodes to be checked by searches with Queue::Buckets
+        AStar::Buckets<Storage> Bins;
+
+        // Lowest cost (from src) found so far
+        typename Storage::template Array<int> Costs;
+
+        // Parent of the node with the lowest cost found so far (None for src)
+        typename Storage::template Array<std::uint32_t> Parents;
+
+        // Path found by the last search
+        AStar::Path Path;
+
+        BasicSearchContext()
+        {
+        }
+
+        // Prepare buffers for a new search on a map with the given number of tiles
+        void Reset(int size)
+        {
+            if (size > (int)Stamps.size())
+            {
+                Stamps.resize(size);
+
+                Costs.resize(size);
+
+                Parents.resize(size);
+
+                Closed.resize((size + 63) / 64);
+            }
+
+            Storage::Recycle(Stamps);
+
+            Storage::Recycle(Costs);
+
+            Storage::Recycle(Parents);
+
+            Storage::Recycle(Closed);
+
+            Open.Reset(size);
+
+            Path.Points.clear();
+
+            Generation++;
+
+            // Stamps from 2^32 searches ago would look current again, so start over
+            if (Generation == 0)
+            {
+                Stamps.assign(Stamps.size(), 0);
+
+                Generation = 1;
+            }
+        }
+
+        // Open list of searches with the given Queue
+        template <AStar::Queue Q>
+        typename std::conditional<Q == AStar::Queue::Heap, AStar::Heap<int, Storage>, AStar::Buckets<Storage>>::type &List()
+        {
+            return Select(std::integral_constant<AStar::Queue, Q>());
+        }
+
+        // Check if tile has been reached during this search
+        bool Seen(int id)
+        {
+            return Stamps[id] == Generation;
+        }
+
+        // Mark tile as reached during this search
+        void See(int id)
+        {
+            Stamps[id] = Generation;
+
+            Open.Forget(id);
+
+            Closed[id >> 6] &= ~(std::uint64_t(1) << (id & 63));
+        }
+
+        // Check if tile has already been visited during this search
+        bool IsClosed(int id)
+        {
+            return Seen(id) && ((Closed[id >> 6] >> (id & 63)) & 1);
+        }
+
+        // Mark tile as visited
+        void Close(int id)
+        {
+            Closed[id >> 6] |= std::uint64_t(1) << (id & 63);
+        }
+
+    private:
+        // Generation in which each tile was last reached
+        typename Storage::template Array<std::uint32_t> Stamps;
+
+        AStar::Heap<int, Storage> &Select(std::integral_constant<AStar::Queue, AStar::Queue::Heap>)
+        {
+            return Open;
+        }
+
+        AStar::Buckets<Storage> &Select(std::integral_constant<AStar::Queue, AStar::Queue::Buckets>)
+        {
+            return Bins;
+        }
+
+        // Visited tiles (closed list) as a bitset
+        typename Storage::template Array<std::uint64_t> Closed;
+
+        std::uint32_t Generation = 0;
+    };
+
+    // Scratch buffers of searches on a Grid
+    typedef AStar::BasicSearchContext<AStar::Dense> SearchContext;
+
+    // Define neighbors (X, Y): Up, Down, Left, Right, then the diagonals (8-connected)
+    const int Neighbors[8][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}, {-1, -1}, {1, -1}, {-1, 1}, {1, 1}};
+
+    // Get all traversable nodes from tile id: calls visit(next, step, dx, dy) for each tile next at
+    // (X + dx, Y + dy) that can be reached in one step, where step is the cost of the step.
+    //
+    // Steps cost 1 (Straight or Diagonal on 8-connected grids) or, if Weighted, that cost multiplied by
+    // the weight of the tile stepped onto. If Reverse, steps are costed as if taken from next to id.
+    //
+    // The map is a Grid or anything that numbers and looks up its tiles the same way (Next, IsPassable
+    // and Weight, see Tiled::Store), with tiles around it that can never be traversed.
+    template <int Connectivity, AStar::Corners Corners, bool Weighted, bool Reverse = false, typename M, typename F>
+    void Expand(M &grid, int id, F visit)
+    {
+        for (auto i = 0; i < Connectivity; i++)
+        {
+            auto dx = AStar::Neighbors[i][0];
+
+            auto dy = AStar::Neighbors[i][1];
+
+            auto next = grid.Next(id, dx, dy);
+
+            // Check if passable and/or leads to destination (the border around the grid is never passable)
+            if (!grid.IsPassable(next))
+            {
+                continue;
+            }
+
+            auto step = 1;
+
+            if (Connectivity == 8)
+            {
+                step = AStar::Straight;
+
+                if (i >= 4)
+                {
+                    auto horizontal = grid.IsPassable(grid.Next(id, dx, 0));
+
+                    auto vertical = grid.IsPassable(grid.Next(id, 0, dy));
+
+                    if ((Corners == AStar::Corners::Avoid && !(horizontal && vertical)) || (Corners == AStar::Corners::Skirt && !(horizontal || vertical)))
+                    {
+                        continue;
+                    }
+
+                    step = AStar::Diagonal;
+                }
+            }
+
+            if (Weighted)
+            {
+                step *= grid.Weight(Reverse ? id : next);
+            }
+
+            visit(next, step, dx, dy);
+        }
+    }
+
+    // A* search (see FindPath below) from all the tiles of sources at once (each starts with a cost of 0)
+    // to tile dst, on a grid where steps cost 1 (Straight or Diagonal on 8-connected grids) or, if
+    // Weighted, that cost multiplied by the weight of the tile stepped onto. If Reverse, steps are costed
+    // as if taken towards the sources and the path leads from dst to the source it came from (see
+    // FindNearest), otherwise from that source to dst. What the search does is recorded in stats (see
+    // Stats), if S records anything.
+    template <int Connectivity, AStar::Corners Corners, bool Weighted, AStar::Queue Queue, bool Reverse = false, typename M, typename C, typename H, typename S>
+    AStar::Path &Search(M &grid, const int *sources, std::size_t count, int dst, C &context, H &heuristic, S &stats)
+    {
+        auto &path = context.Path;
+
+        path.Points.clear();
+
+        stats.Start();
+
+        if (dst < 0)
+        {
+            stats.Stop();
+
+            return path;
+        }
+
+        context.Reset(grid.Size());
+
+        // List of nodes to be checked (open list) keyed on CostDistance
+        auto &active = context.template List<Queue>();
+
+        active.Reset(grid.Size());
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto src = sources[i];
+
+            // Paths end on the sources of a Reverse search, so those that cannot be stepped onto are left out
+            if (src < 0 || src >= grid.Size() || (Reverse && !grid.IsPassable(src)) || context.Seen(src))
+            {
+                continue;
+            }
+
+            context.See(src);
+
+            context.Costs[src] = 0;
+
+            context.Parents[src] = AStar::None;
+
+            active.Push(src, heuristic(src, grid.X(src), grid.Y(src)), 0);
+
+            stats.Estimate();
+
+            stats.Generate();
+        }
+
+        stats.Open(active.Size());
+
+        stats.Enter(AStar::Phase::Search);
+
+        while (!active.Empty())
+        {
+            // Get the node with the lowest CostDistance
+            auto priority = active.Key(active.Top());
+
+            auto id = active.Pop();
+
+            if (id == dst)
+            {
+                stats.Enter(AStar::Phase::Path);
+
+                // We found the destination and we can be sure (because of the heap order above)
+                // that it's the most low cost option.
+                for (auto node = (std::uint32_t)id; node != AStar::None; node = context.Parents[node])
+                {
+                    path.Points.push_back(AStar::Point(grid.X(node), grid.Y(node)));
+                }
+
+                // Reverse list of coordinates so path leads from src to dst
+                if (!Reverse)
+                {
+                    std::reverse(path.Points.begin(), path.Points.end());
+                }
+
+                stats.Stop();
+
+                return path;
+            }
+
+            context.Close(id);
+
+            auto x = grid.X(id);
+
+            auto y = grid.Y(id);
+
+            stats.Expand(x, y, context.Costs[id], priority - context.Costs[id]);
+
+            auto visit = [&](int next, int step, int dx, int dy)
+            {
+                auto cost = context.Costs[id] + step;
+
+                auto distance = cost + heuristic(next, x + dx, y + dy);
+
+                stats.Estimate();
+
+                if (!context.Seen(next))
+                {
+                    // We've never seen this node before so add it to the list.
+                    context.See(next);
+
+                    context.Costs[next] = cost;
+
+                    context.Parents[next] = id;
+
+                    active.Push(next, distance, cost);
+
+                    stats.Generate();
+
+                    stats.Open(active.Size());
+                }
+                else if (context.IsClosed(next))
+                {
+                    // We have already visited this node so we don't need to do so again!
+                    return;
+                }
+                else if (cost < context.Costs[next])
+                {
+                    // It's already in the active list, but that's OK, maybe this new node has a better value (e.g. We might zigzag earlier but this is now straighter).
+                    context.Costs[next] = cost;
+
+                    context.Parents[next] = id;
+
+                    active.Decrease(next, distance, cost);
+
+                    stats.Reopen();
+                }
+            };
+
+            AStar::Expand<Connectivity, Corners, Weighted, Reverse>(grid, id, visit);
+        }
+
+        stats.Stop();
+
+        return path;
+    }
+
+    // A* search from tile src to tile dst (see Search above)
+    template <int Connectivity, AStar::Corners Corners, bool Weighted, AStar::Queue Queue, typename M, typename C, typename H, typename S>
+    AStar::Path &Search(M &grid, int src, int dst, C &context, H &heuristic, S &stats)
+    {
+        return AStar::Search<Connectivity, Corners, Weighted, Queue>(grid, &src, 1, dst, context, heuristic, stats);
+    }
+
+    // Same as FindPath below, with heuristic(id, x, y) estimating the cost of reaching dst from tile id at
+    // (x, y) instead of Heuristic (see Landmarks) and what the search does recorded in stats (see Stats,
+    // or NoStats to record nothing). The heuristic must never overestimate the cost.
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap, typename M, typename Storage, typename H, typename S>
+    AStar::Path &FindPath(M &grid, int src, int dst, AStar::BasicSearchContext<Storage> &context, H &heuristic, S &stats)
+    {
+        static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+        if (grid.IsWeighted())
+        {
+            return AStar::Search<Connectivity, Corners, true, Queue>(grid, src, dst, context, heuristic, stats);
+        }
+
+        return AStar::Search<Connectivity, Corners, false, Queue>(grid, src, dst, context, heuristic, stats);
+    }
+
+    // Same as FindPath below, with heuristic(id, x, y) estimating the cost of reaching dst from tile id at
+    // (x, y) instead of Heuristic (see Landmarks). It must never overestimate the cost.
+    //
+    // Classes derived from Stats (see Trace) are taken by the overload below, not as a heuristic
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap, typename M, typename Storage, typename H>
+    typename std::enable_if<!std::is_base_of<AStar::Stats, H>::value, AStar::Path &>::type FindPath(M &grid, int src, int dst, AStar::BasicSearchContext<Storage> &context, H &heuristic)
+    {
+        auto stats = AStar::NoStats();
+
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, src, dst, context, heuristic, stats);
+    }
+
+    // Same as FindPath below, with what the search does recorded in stats
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap, typename M, typename Storage>
+    AStar::Path &FindPath(M &grid, int src, int dst, AStar::BasicSearchContext<Storage> &context, AStar::Stats &stats)
+    {
+        if (src < 0 || dst < 0)
+        {
+            stats.Start();
+
+            stats.Stop();
+
+            context.Path.Points.clear();
+
+            return context.Path;
+        }
+
+        auto heuristic = AStar::Heuristic<Connectivity>(grid, dst);
+
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, src, dst, context, heuristic, stats);
+    }
+
+    // Find path from tile src to tile dst (see Grid::Index) using the A* algorithm
+    //
+    // Moves are restricted to Up, Down, Left and Right (Connectivity = 4) or may also be diagonal
+    // (Connectivity = 8), in which case Corners decides when a diagonal move may pass an obstacle.
+    // On weighted grids, stepping onto a tile costs its weight (see Grid::Weights) times the cost of the step.
+    //
+    // The grid may also be a map kept in a file (see Tiled::Store), searched with a Tiled::SearchContext.
+    //
+    // The path is kept in the given context and remains valid until its next search
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap, typename M, typename Storage>
+    AStar::Path &FindPath(M &grid, int src, int dst, AStar::BasicSearchContext<Storage> &context)
+    {
+        if (src < 0 || dst < 0)
+        {
+            context.Path.Points.clear();
+
+            return context.Path;
+        }
+
+        auto heuristic = AStar::Heuristic<Connectivity>(grid, dst);
+
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, src, dst, context, heuristic);
+    }
+
+    // Find the cost of the cheapest path from tile src to every tile it can reach (or, if Reverse, to src
+    // from every tile that can reach it): A* without a destination, i.e. Dijkstra's algorithm.
+    //
+    // Costs are left in context for the tiles it has seen (see SearchContext::Seen).
+    template <int Connectivity, AStar::Corners Corners, bool Weighted, bool Reverse>
+    void Dijkstra(AStar::Grid &grid, int src, AStar::SearchContext &context)
+    {
+        context.Reset(grid.Size());
+
+        auto &active = context.Open;
+
+        context.See(src);
+
+        context.Costs[src] = 0;
+
+        context.Parents[src] = AStar::None;
+
+        active.Push(src, 0);
+
+        while (!active.Empty())
+        {
+            auto id = active.Pop();
+
+            context.Close(id);
+
+            auto visit = [&](int next, int step, int, int)
+            {
+                auto cost = context.Costs[id] + step;
+
+                if (!context.Seen(next))
+                {
+                    context.See(next);
+
+                    context.Costs[next] = cost;
+
+                    context.Parents[next] = id;
+
+                    active.Push(next, cost);
+                }
+                else if (!context.IsClosed(next) && cost < context.Costs[next])
+                {
+                    context.Costs[next] = cost;
+
+                    context.Parents[next] = id;
+
+                    active.Decrease(next, cost);
+                }
+            };
+
+            AStar::Expand<Connectivity, Corners, Weighted, Reverse>(grid, id, visit);
+        }
+    }
+
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, bool Reverse = false>
+    void Flood(AStar::Grid &grid, int src, AStar::SearchContext &context)
+    {
+        static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+        if (grid.IsWeighted())
+        {
+            AStar::Dijkstra<Connectivity, Corners, true, Reverse>(grid, src, context);
+        }
+        else
+        {
+            AStar::Dijkstra<Connectivity, Corners, false, Reverse>(grid, src, context);
+        }
+    }
+
+    // Find path from src to dst using the A* algorithm
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap, typename M, typename Storage>
+    AStar::Path &FindPath(M &grid, const char src, const char dst, AStar::BasicSearchContext<Storage> &context)
+    {
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, grid.Find(src), grid.Find(dst), context);
+    }
+
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap, typename M, typename Storage>
+    AStar::Path &FindPath(M &grid, const char src, const char dst, AStar::BasicSearchContext<Storage> &context, AStar::Stats &stats)
+    {
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, grid.Find(src), grid.Find(dst), context, stats);
+    }
+
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap>
+    AStar::Path FindPath(AStar::Grid &grid, const char src, const char dst)
+    {
+        auto context = AStar::SearchContext();
+
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, src, dst, context);
+    }
+
+    // Find path from src to dst using the A* algorithm
+    //
+    // Search buffers are reused from the given context
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap>
+    AStar::Path FindPath(std::vector<std::string> &map, const char src, const char dst, const char passable, AStar::SearchContext &context)
+    {
+        auto grid = AStar::Grid(map, passable, std::string({src, dst}));
+
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, src, dst, context);
+    }
+
+    // Find path from src to dst using the A* algorithm
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap>
+    AStar::Path FindPath(std::vector<std::string> &map, const char src, const char dst, const char passable)
+    {
+        auto context = AStar::SearchContext();
+
+        return AStar::FindPath<Connectivity, Corners, Queue>(map, src, dst, passable, context);
+    }
+
+    // Find path from src to dst using the A* algorithm, with the cost of each tile given by terrain
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap>
+    AStar::Path FindPath(std::vector<std::string> &map, const char src, const char dst, const AStar::Terrain &terrain)
+    {
+        auto grid = AStar::Grid(map, terrain, std::string({src, dst}));
+
+        auto context = AStar::SearchContext();
+
+        return AStar::FindPath<Connectivity, Corners, Queue>(grid, src, dst, context);
     }
 }
 #endif
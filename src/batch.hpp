@@ -0,0 +1,275 @@
+#ifndef __BATCH_HPP__
+#define __BATCH_HPP__
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "astarv2.hpp"
+
+namespace AStar
+{
+    // Query for a path from src (first) to dst (second)
+    typedef std::pair<AStar::Point, AStar::Point> Query;
+
+    // Runs many searches on one grid in parallel. The grid is only read, so it is shared by all threads.
+    //
+    // Each thread owns a SearchContext. Queries are split evenly between the threads and a thread that
+    // runs out of queries steals half of the queries left to another thread (work stealing), so threads
+    // stay busy even when some searches take much longer than others.
+    //
+    // Threads (and their contexts) are kept from one batch to the next, so create a Batch once and reuse it.
+    class Batch
+    {
+    public:
+        Batch(int threads = std::thread::hardware_concurrency())
+        {
+            threads = std::max(threads, 1);
+
+            for (auto i = 0; i < threads; i++)
+            {
+                Workers.push_back(std::make_unique<Worker>());
+            }
+
+            // The calling thread works as the first worker
+            for (auto i = 1; i < threads; i++)
+            {
+                Pool.push_back(std::thread(&Batch::Loop, this, i));
+            }
+        }
+
+        ~Batch()
+        {
+            {
+                std::lock_guard<std::mutex> lock(Lock);
+
+                Stop = true;
+            }
+
+            Start.notify_all();
+
+            for (auto &thread : Pool)
+            {
+                thread.join();
+            }
+        }
+
+        Batch(const Batch &) = delete;
+
+        Batch &operator=(const Batch &) = delete;
+
+        int Threads()
+        {
+            return Workers.size();
+        }
+
+        // Find the paths for all queries (see FindPath). paths[i] is the path for queries[i] and is empty
+        // if there is none. Reusing paths from one batch to the next avoids reallocating them.
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        void FindPaths(AStar::Grid &grid, std::vector<AStar::Query> &queries, std::vector<AStar::Path> &paths)
+        {
+            paths.resize(queries.size());
+
+            Run(queries.size(), [&](int i, AStar::SearchContext &context)
+                {
+                    auto &src = queries[i].first;
+
+                    auto &dst = queries[i].second;
+
+                    auto from = grid.Contains(src.X, src.Y) ? grid.Index(src.X, src.Y) : -1;
+
+                    auto to = grid.Contains(dst.X, dst.Y) ? grid.Index(dst.X, dst.Y) : -1;
+
+                    paths[i].Points = AStar::FindPath<Connectivity, Corners>(grid, from, to, context).Points;
+                });
+        }
+
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        std::vector<AStar::Path> FindPaths(AStar::Grid &grid, std::vector<AStar::Query> &queries)
+        {
+            auto paths = std::vector<AStar::Path>();
+
+            FindPaths<Connectivity, Corners>(grid, queries, paths);
+
+            return paths;
+        }
+
+        // Run job(i, context) for i = 0 to count - 1 on all threads, each with its own context
+        void Run(int count, std::function<void(int, AStar::SearchContext &)> job)
+        {
+            if (count <= 0)
+            {
+                return;
+            }
+
+            auto threads = (int)Workers.size();
+
+            for (auto i = 0; i < threads; i++)
+            {
+                Workers[i]->Begin = (long long)count * i / threads;
+
+                Workers[i]->End = (long long)count * (i + 1) / threads;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(Lock);
+
+                Job = job;
+
+                Running = threads - 1;
+
+                Generation++;
+            }
+
+            Start.notify_all();
+
+            Work(0);
+
+            std::unique_lock<std::mutex> lock(Lock);
+
+            Done.wait(lock, [&]
+                      { return Running == 0; });
+        }
+
+    private:
+        // Queries left to a thread (Begin to End - 1) and its search buffers
+        struct Worker
+        {
+            std::mutex Lock;
+
+            int Begin = 0;
+
+            int End = 0;
+
+            AStar::SearchContext Context;
+        };
+
+        std::vector<std::unique_ptr<Worker>> Workers;
+
+        std::vector<std::thread> Pool;
+
+        std::function<void(int, AStar::SearchContext &)> Job;
+
+        // Guards Job, Running, Generation and Stop
+        std::mutex Lock;
+
+        std::condition_variable Start;
+
+        std::condition_variable Done;
+
+        // Number of threads (other than the calling thread) still working on the current batch
+        int Running = 0;
+
+        // Number of batches started so far
+        std::uint64_t Generation = 0;
+
+        bool Stop = false;
+
+        void Loop(int worker)
+        {
+            std::uint64_t generation = 0;
+
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(Lock);
+
+                    Start.wait(lock, [&]
+                               { return Stop || Generation != generation; });
+
+                    if (Stop)
+                    {
+                        return;
+                    }
+
+                    generation = Generation;
+                }
+
+                Work(worker);
+
+                {
+                    std::lock_guard<std::mutex> lock(Lock);
+
+                    Running--;
+
+                    if (Running == 0)
+                    {
+                        Done.notify_one();
+                    }
+                }
+            }
+        }
+
+        void Work(int worker)
+        {
+            auto &self = *Workers[worker];
+
+            int next;
+
+            while (Take(self, next) || (Steal(worker) && Take(self, next)))
+            {
+                Job(next, self.Context);
+            }
+        }
+
+        // Take the next query from a thread's own share
+        bool Take(Worker &worker, int &next)
+        {
+            std::lock_guard<std::mutex> lock(worker.Lock);
+
+            if (worker.Begin >= worker.End)
+            {
+                return false;
+            }
+
+            next = worker.Begin++;
+
+            return true;
+        }
+
+        // Move the last half of another thread's queries to this thread's share
+        bool Steal(int thief)
+        {
+            auto threads = (int)Workers.size();
+
+            for (auto i = 1; i < threads; i++)
+            {
+                auto &victim = *Workers[(thief + i) % threads];
+
+                int begin, end;
+
+                {
+                    std::lock_guard<std::mutex> lock(victim.Lock);
+
+                    auto left = victim.End - victim.Begin;
+
+                    if (left <= 0)
+                    {
+                        continue;
+                    }
+
+                    begin = victim.End - (left + 1) / 2;
+
+                    end = victim.End;
+
+                    victim.End = begin;
+                }
+
+                auto &self = *Workers[thief];
+
+                std::lock_guard<std::mutex> lock(self.Lock);
+
+                self.Begin = begin;
+
+                self.End = end;
+
+                return true;
+            }
+
+            return false;
+        }
+    };
+}
+#endif
@@ -0,0 +1,775 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(USEV1)
+#include "astar.hpp"
+#else
+#include "batch.hpp"
+#include "bidirectional.hpp"
+#include "dstar.hpp"
+#include "flowfield.hpp"
+#include "hpa.hpp"
+#include "jps.hpp"
+#include "landmarks.hpp"
+#include "nearest.hpp"
+#include "tiled.hpp"
+#endif
+
+#include "maze.hpp"
+
+// Benchmark for the pathfinding engines.
+//
+// Every engine runs the same fixed set of queries on the same reproducible maps (seeded mazes, open
+// fields, random obstacles and the examples/ files) and one JSON object is printed per map and engine:
+//
+//   {"map": "maze-128", "engine": "astarv2", "queries": 100, "found": 100, "steps": 41234,
+//    "qps": 5120.3, "p50_us": 150.2, "p99_us": 610.9, "expanded": 8123.4, "setup_ms": 1.2,
+//    "baseline_kb": 4096, "peak_kb": 9216}
+//
+// Runs stop after the queries that took them past a time budget (see Options) and runs that take far
+// longer are reported as timed out, so the slowest engines do not hold up the rest.
+//
+// steps is the total length of the paths found, so engines that should find equally short paths can be
+// compared. expanded is the mean number of tiles expanded per query (null where the engine does not
+// expose it). Each run takes place in a process of its own, so peak_kb is the peak memory of that engine
+// alone (baseline_kb is the memory already in use once the map is built, before the engine is set up).
+//
+// astar.hpp cannot be built alongside astarv2.hpp, so it is benchmarked by its own executable (see the
+// benchmark target of the Makefile).
+
+// Map with the queries to run on it. Only ' ' can be traversed.
+struct Workload
+{
+    std::string Name;
+
+    std::vector<std::string> Map;
+
+    std::vector<std::pair<AStar::Point, AStar::Point>> Queries;
+};
+
+struct Options
+{
+    int Queries = 100;
+
+    std::uint64_t Seed = 1;
+
+    // Seconds an engine may spend on the queries of a map before the rest are skipped
+    double Budget = 10;
+
+    // Only run maps and engines whose names contain these
+    std::string Map;
+
+    std::string Engine;
+};
+
+// Result of one query: whether a path was found, its length and the number of tiles expanded (-1 if unknown)
+struct Outcome
+{
+    bool Found;
+
+    int Steps;
+
+    long long Expanded;
+};
+
+// Map of a maze of cells by cells rooms, as maze.exe draws it but with '#' for every wall
+class Walls
+{
+public:
+    std::vector<std::string> Map;
+
+    Walls(int cells) : Map(cells * 2 + 1, std::string(cells * 2 + 1, '#'))
+    {
+    }
+
+    bool Row(int y, const std::uint8_t *cells)
+    {
+        for (auto x = 0; x < (int)Map.size() / 2; x++)
+        {
+            Map[y * 2 + 1][x * 2 + 1] = ' ';
+
+            if (cells[x] & Maze::East)
+            {
+                Map[y * 2 + 1][x * 2 + 2] = ' ';
+            }
+
+            if (cells[x] & Maze::South)
+            {
+                Map[y * 2 + 2][x * 2 + 1] = ' ';
+            }
+        }
+
+        return true;
+    }
+};
+
+// Maze of cells by cells rooms, carved by the same depth-first search as maze.exe
+std::vector<std::string> Carve(int cells, Maze::Random &random)
+{
+    auto walls = Walls(cells);
+
+    Maze::Backtrack(cells, cells, random, walls);
+
+    return walls.Map;
+}
+
+// Map of the given size where each tile is an obstacle with the given probability (in percent)
+std::vector<std::string> Field(int size, int density, Maze::Random &random)
+{
+    auto map = std::vector<std::string>(size, std::string(size, ' '));
+
+    for (auto &row : map)
+    {
+        for (auto &c : row)
+        {
+            if (random.Below(100) < density)
+            {
+                c = '#';
+            }
+        }
+    }
+
+    return map;
+}
+
+// Pick count queries between tiles that can be traversed
+void Pick(Workload &workload, int count, Maze::Random &random)
+{
+    auto tiles = std::vector<AStar::Point>();
+
+    for (auto y = 0; y < (int)workload.Map.size(); y++)
+    {
+        for (auto x = 0; x < (int)workload.Map[y].length(); x++)
+        {
+            if (workload.Map[y][x] == ' ')
+            {
+                tiles.push_back(AStar::Point(x, y));
+            }
+        }
+    }
+
+    // Tiles are only both ends of a query if there is no other tile (astar.hpp finds them by their symbols)
+    while ((int)workload.Queries.size() < count && !tiles.empty())
+    {
+        auto src = random.Below(tiles.size());
+
+        auto dst = random.Below(tiles.size());
+
+        while (dst == src && tiles.size() > 1)
+        {
+            dst = random.Below(tiles.size());
+        }
+
+        workload.Queries.push_back({tiles[src], tiles[dst]});
+    }
+}
+
+// Names of the maps, in the order they are run
+std::vector<std::string> Maps()
+{
+    auto names = std::vector<std::string>({"maze-32", "maze-128", "maze-512", "open-256", "open-1024", "random-256", "random-1024"});
+
+    auto examples = std::vector<std::string>();
+
+    if (auto directory = opendir("examples"))
+    {
+        while (auto entry = readdir(directory))
+        {
+            auto name = std::string(entry->d_name);
+
+            if (name.size() > 4 && name.substr(name.size() - 4) == ".txt")
+            {
+                examples.push_back(name.substr(0, name.size() - 4));
+            }
+        }
+
+        closedir(directory);
+    }
+
+    std::sort(examples.begin(), examples.end());
+
+    names.insert(names.end(), examples.begin(), examples.end());
+
+    return names;
+}
+
+// Build the map with the given name and its queries (always the same ones for the same seed)
+Workload Generate(const std::string &name, const Options &options)
+{
+    auto workload = Workload();
+
+    workload.Name = name;
+
+    // Seeded from the name as well (FNV-1a rather than std::hash, which differs between libraries)
+    auto seed = options.Seed;
+
+    for (auto c : name)
+    {
+        seed = (seed ^ (unsigned char)c) * 0x100000001B3ull;
+    }
+
+    auto random = Maze::Random(seed);
+
+    auto dash = name.find('-');
+
+    auto size = dash == std::string::npos ? 0 : std::stoi(name.substr(dash + 1));
+
+    if (name.rfind("maze-", 0) == 0)
+    {
+        workload.Map = Carve(size, random);
+    }
+    else if (name.rfind("open-", 0) == 0)
+    {
+        workload.Map = Field(size, 0, random);
+    }
+    else if (name.rfind("random-", 0) == 0)
+    {
+        workload.Map = Field(size, 30, random);
+    }
+    else
+    {
+        // The first query of an example goes from A to B, which are then cleared for the other engines
+        std::ifstream file("examples/" + name + ".txt");
+
+        std::string str;
+
+        while (std::getline(file, str))
+        {
+            workload.Map.push_back(str);
+        }
+
+        auto src = AStar::Point(-1, -1);
+
+        auto dst = AStar::Point(-1, -1);
+
+        for (auto y = 0; y < (int)workload.Map.size(); y++)
+        {
+            for (auto x = 0; x < (int)workload.Map[y].length(); x++)
+            {
+                auto &c = workload.Map[y][x];
+
+                if (c == 'A' || c == 'B')
+                {
+                    (c == 'A' ? src : dst) = AStar::Point(x, y);
+
+                    c = ' ';
+                }
+            }
+        }
+
+        if (src.X >= 0 && dst.X >= 0)
+        {
+            workload.Queries.push_back({src, dst});
+        }
+    }
+
+    Pick(workload, options.Queries, random);
+
+    return workload;
+}
+
+// Peak memory of this process so far
+long PeakMemory()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+double Since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Print the results of an engine on a map as a line of JSON. latencies holds the seconds each query took.
+void Report(Workload &workload, const std::string &engine, std::vector<Outcome> &outcomes, std::vector<double> &latencies, double elapsed, double setup, long baseline)
+{
+    auto found = 0;
+
+    auto steps = 0LL;
+
+    auto expanded = 0LL;
+
+    auto known = true;
+
+    for (auto &outcome : outcomes)
+    {
+        found += outcome.Found;
+
+        steps += outcome.Found ? outcome.Steps : 0;
+
+        expanded += outcome.Expanded;
+
+        known = known && outcome.Expanded >= 0;
+    }
+
+    auto sorted = latencies;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&](double p)
+    {
+        return sorted.empty() ? 0 : sorted[std::min((int)(p * sorted.size()), (int)sorted.size() - 1)] * 1e6;
+    };
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "{\"map\": \"" << workload.Name << "\", \"engine\": \"" << engine << "\""
+              << ", \"queries\": " << outcomes.size() << ", \"found\": " << found << ", \"steps\": " << steps
+              << ", \"qps\": " << (elapsed > 0 ? outcomes.size() / elapsed : 0)
+              << ", \"p50_us\": " << percentile(0.5) << ", \"p99_us\": " << percentile(0.99) << ", \"expanded\": ";
+
+    if (known && !outcomes.empty())
+    {
+        std::cout << (double)expanded / outcomes.size();
+    }
+    else
+    {
+        std::cout << "null";
+    }
+
+    std::cout << ", \"setup_ms\": " << setup * 1e3 << ", \"baseline_kb\": " << baseline << ", \"peak_kb\": " << PeakMemory() << "}" << std::endl;
+}
+
+// Run the queries of workload one after another with search(src, dst), which returns the path found,
+// until they are done or the budget is spent. Only search is timed; expanded() then gives the number of
+// tiles it expanded (-1 if unknown).
+template <typename F, typename G>
+void Measure(Workload &workload, const std::string &engine, const Options &options, double setup, long baseline, F search, G expanded)
+{
+    auto outcomes = std::vector<Outcome>();
+
+    auto latencies = std::vector<double>();
+
+    auto elapsed = 0.0;
+
+    for (auto &pair : workload.Queries)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        auto &&path = search(pair.first, pair.second);
+
+        latencies.push_back(Since(start));
+
+        elapsed += latencies.back();
+
+        outcomes.push_back(Outcome{!path.Points.empty(), (int)path.Points.size() - 1, expanded()});
+
+        if (elapsed > options.Budget)
+        {
+            break;
+        }
+    }
+
+    Report(workload, engine, outcomes, latencies, elapsed, setup, baseline);
+}
+
+// Engine does not tell how many tiles it expanded
+long long Unknown()
+{
+    return -1;
+}
+
+#if defined(USEV1)
+std::vector<std::string> Engines()
+{
+    return {"astar"};
+}
+
+bool Run(Workload &workload, const std::string &, const Options &options)
+{
+    auto baseline = PeakMemory();
+
+    auto search = [&](AStar::Point src, AStar::Point dst)
+    {
+        // This version finds src and dst by their symbols on the map
+        workload.Map[src.Y][src.X] = 'A';
+
+        workload.Map[dst.Y][dst.X] = 'B';
+
+        auto path = AStar::FindPath(workload.Map, 'A', 'B', ' ');
+
+        workload.Map[src.Y][src.X] = ' ';
+
+        workload.Map[dst.Y][dst.X] = ' ';
+
+        return path;
+    };
+
+    Measure(workload, "astar", options, 0, baseline, search, Unknown);
+
+    return true;
+}
+#else
+std::vector<std::string> Engines()
+{
+    return {"astarv2", "buckets", "nearest", "jps", "bidirectional", "alt", "hpa", "dstar", "flowfield", "tiled", "batch"};
+}
+
+// Number of tiles expanded by the last search with context
+long long Expanded(AStar::Grid &grid, AStar::SearchContext &context)
+{
+    auto count = 0LL;
+
+    for (auto id = 0; id < grid.Size(); id++)
+    {
+        count += context.IsClosed(id);
+    }
+
+    return count;
+}
+
+// Set engine up on the map of workload and run its queries (false if it could not be set up)
+bool Run(Workload &workload, const std::string &engine, const Options &options)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    auto grid = AStar::Grid(workload.Map, ' ', "");
+
+    auto context = AStar::SearchContext();
+
+    auto baseline = PeakMemory();
+
+    auto index = [&](AStar::Point point)
+    {
+        return grid.Index(point.X, point.Y);
+    };
+
+    // Searches that can record what they do (see AStar::Stats)
+    auto stats = AStar::Stats();
+
+    auto expanded = [&]
+    {
+        return stats.Expanded;
+    };
+
+    auto closed = [&]
+    {
+        return Expanded(grid, context);
+    };
+
+    if (engine == "astarv2")
+    {
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            return AStar::FindPath(grid, index(src), index(dst), context, stats);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, expanded);
+    }
+    else if (engine == "buckets")
+    {
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            return AStar::FindPath<4, AStar::Corners::Avoid, AStar::Queue::Buckets>(grid, index(src), index(dst), context, stats);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, expanded);
+    }
+    else if (engine == "nearest")
+    {
+        // Backward search to a single goal, so its paths are as short as those of astarv2
+        auto goals = std::vector<int>(1);
+
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            goals[0] = index(dst);
+
+            return AStar::FindNearest(grid, index(src), goals, context, stats);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, expanded);
+    }
+    else if (engine == "jps")
+    {
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            return AStar::JPS::FindPath(grid, index(src), index(dst), context);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, closed);
+    }
+    else if (engine == "bidirectional")
+    {
+        auto backward = AStar::SearchContext();
+
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            return AStar::Bidirectional::FindPath(grid, index(src), index(dst), context, backward);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, [&]
+                { return Expanded(grid, context) + Expanded(grid, backward); });
+    }
+    else if (engine == "alt")
+    {
+        auto landmarks = AStar::Landmarks<>();
+
+        landmarks.Build(grid);
+
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            return AStar::FindPath(grid, index(src), index(dst), context, landmarks, stats);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, expanded);
+    }
+    else if (engine == "hpa")
+    {
+        auto graph = AStar::HPA::Graph<>(grid);
+
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            return graph.FindPath(index(src), index(dst), context);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, Unknown);
+    }
+    else if (engine == "dstar")
+    {
+        // A planner is made for each query, so this is the cost of planning the first path
+        auto planner = std::unique_ptr<AStar::DStar::Planner<>>();
+
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            planner = std::make_unique<AStar::DStar::Planner<>>(grid, index(src), index(dst));
+
+            return planner->FindPath();
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, [&]
+                { return (long long)planner->Expanded; });
+    }
+    else if (engine == "flowfield")
+    {
+        // A field is built towards the destination of each query, then followed from its source, so
+        // this is the cost of a field that only one agent uses
+        auto field = AStar::FlowField();
+
+        auto goals = std::vector<int>(1);
+
+        auto path = AStar::Path();
+
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            goals[0] = index(dst);
+
+            field.Build(grid, goals);
+
+            path.Points.clear();
+
+            if (field.Distance(src.X, src.Y) != AStar::FlowField::Unreachable)
+            {
+                for (auto point = src; path.Points.empty() || point.X != path.Points.back().X || point.Y != path.Points.back().Y; point = field.Next(point.X, point.Y))
+                {
+                    path.Points.push_back(point);
+                }
+            }
+
+            return path;
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, Unknown);
+    }
+    else if (engine == "tiled")
+    {
+        // The map goes through a file, as tiled maps are only ever read from one
+        char text[] = "/tmp/benchmarkXXXXXX";
+
+        auto file = mkstemp(text);
+
+        auto tiles = std::string(text) + ".tiles";
+
+        std::ofstream(text) << [&]
+        {
+            auto stream = std::ostringstream();
+
+            for (auto &row : workload.Map)
+            {
+                stream << row << "\n";
+            }
+
+            return stream.str();
+        }();
+
+        auto store = AStar::Tiled::Store();
+
+        auto ok = AStar::Tiled::Store::Write(text, tiles, AStar::Terrain(' '), "") && store.Open(tiles);
+
+        close(file);
+
+        unlink(text);
+
+        unlink(tiles.c_str());
+
+        if (!ok)
+        {
+            return false;
+        }
+
+        auto local = AStar::Tiled::SearchContext();
+
+        auto search = [&](AStar::Point src, AStar::Point dst) -> AStar::Path &
+        {
+            return AStar::FindPath(store, store.Index(src.X, src.Y), store.Index(dst.X, dst.Y), local, stats);
+        };
+
+        Measure(workload, engine, options, Since(start), baseline, search, expanded);
+    }
+    else if (engine == "batch")
+    {
+        // All queries at once on every core: qps is the throughput of the batch and the latencies are
+        // those of the queries within it
+        auto batch = AStar::Batch();
+
+        auto setup = Since(start);
+
+        auto count = (int)workload.Queries.size();
+
+        auto outcomes = std::vector<Outcome>(count);
+
+        auto latencies = std::vector<double>(count);
+
+        start = std::chrono::steady_clock::now();
+
+        batch.Run(count, [&](int i, AStar::SearchContext &context)
+                  {
+                      auto begin = std::chrono::steady_clock::now();
+
+                      auto &query = workload.Queries[i];
+
+                      auto &path = AStar::FindPath(grid, index(query.first), index(query.second), context);
+
+                      latencies[i] = Since(begin);
+
+                      outcomes[i] = Outcome{!path.Points.empty(), (int)path.Points.size() - 1, -1}; });
+
+        Report(workload, engine, outcomes, latencies, Since(start), setup, baseline);
+    }
+
+    return true;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    auto options = Options();
+
+    auto usage = [&]()
+    {
+        std::cerr << "Usage: " << argv[0] << " [--queries N] [--seed N] [--budget seconds] [--map name] [--engine name]" << std::endl;
+
+        return 1;
+    };
+
+    // Every flag takes a value, so a flag without one is as wrong as a flag that is not known
+    for (auto i = 1; i < argc; i += 2)
+    {
+        auto flag = std::string(argv[i]);
+
+        if (i + 1 >= argc)
+        {
+            return usage();
+        }
+
+        try
+        {
+            if (flag == "--queries")
+            {
+                options.Queries = std::stoi(argv[i + 1]);
+            }
+            else if (flag == "--seed")
+            {
+                options.Seed = std::stoull(argv[i + 1]);
+            }
+            else if (flag == "--budget")
+            {
+                options.Budget = std::stod(argv[i + 1]);
+            }
+            else if (flag == "--map")
+            {
+                options.Map = argv[i + 1];
+            }
+            else if (flag == "--engine")
+            {
+                options.Engine = argv[i + 1];
+            }
+            else
+            {
+                return usage();
+            }
+        }
+        catch (const std::exception &)
+        {
+            return usage();
+        }
+    }
+
+    for (auto &map : Maps())
+    {
+        if (map.find(options.Map) == std::string::npos)
+        {
+            continue;
+        }
+
+        for (auto &engine : Engines())
+        {
+            if (engine.find(options.Engine) == std::string::npos)
+            {
+                continue;
+            }
+
+            // Each run gets a process of its own so that its peak memory is its own
+            std::cout.flush();
+
+            auto child = fork();
+
+            if (child == 0)
+            {
+                // The budget is only checked between queries, so a single query that runs far longer
+                // is stopped here
+                alarm((unsigned)(options.Budget * 2) + 10);
+
+                auto workload = Generate(map, options);
+
+                auto ok = Run(workload, engine, options);
+
+                std::cout.flush();
+
+                _exit(ok ? 0 : 1);
+            }
+
+            auto status = 0;
+
+            waitpid(child, &status, 0);
+
+            if (child < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                auto error = WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM ? "timed out" : "run failed";
+
+                std::cout << "{\"map\": \"" << map << "\", \"engine\": \"" << engine << "\", \"error\": \"" << error << "\"}" << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
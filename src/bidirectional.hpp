@@ -0,0 +1,351 @@
+#ifndef __BIDIRECTIONAL_HPP__
+#define __BIDIRECTIONAL_HPP__
+
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "astarv2.hpp"
+
+// Bidirectional A*: one search runs from src towards dst and another from dst towards src.
+//
+// Whenever a search improves the cost of a tile already reached by the other one, the path through that
+// tile becomes a candidate. Both searches stop once either of them can no longer find anything cheaper
+// than the best candidate (its lowest CostDistance is not lower than the candidate's cost), at which point
+// the candidate is the shortest path. On long corridor-like maps, the two smaller wavefronts explore far
+// fewer tiles than a single one.
+//
+// The two searches can also run on two threads (see FindPath).
+namespace AStar
+{
+    namespace Bidirectional
+    {
+        // Best path found so far: its cost and the tile where both searches meet
+        struct Meeting
+        {
+            int Cost = INT_MAX;
+
+            int Tile = -1;
+        };
+
+        // One of the two searches. Reverse searches run from dst towards src, so their steps are costed
+        // as if taken in the opposite direction (see Expand).
+        template <int Connectivity, AStar::Corners Corners, bool Weighted, bool Reverse>
+        class Frontier
+        {
+        public:
+            AStar::SearchContext &Context;
+
+            // Tiles whose cost has improved (only kept if Track is set)
+            std::vector<int> Touched;
+
+            bool Track = false;
+
+            Frontier(AStar::Grid &grid, AStar::SearchContext &context, int src, int dst) : Context(context), Map(grid)
+            {
+                X = grid.X(dst);
+
+                Y = grid.Y(dst);
+
+                Minimum = Weighted ? grid.MinimumWeight : 1;
+
+                Context.Reset(grid.Size());
+
+                Context.See(src);
+
+                Context.Costs[src] = 0;
+
+                Context.Parents[src] = AStar::None;
+
+                Context.Open.Push(src, AStar::Distance<Connectivity>(grid.X(src), grid.Y(src), X, Y) * Minimum);
+            }
+
+            // Lowest CostDistance on the open list (INT_MAX if it is empty)
+            int Top()
+            {
+                return Context.Open.Empty() ? INT_MAX : Context.Open.Key(Context.Open.Top());
+            }
+
+            // Expand the node with the lowest CostDistance. If other (the search running in the opposite
+            // direction) is given, tiles it has reached are checked for a better meeting point.
+            void Expand(AStar::SearchContext *other, AStar::Bidirectional::Meeting &best)
+            {
+                auto id = Context.Open.Pop();
+
+                Context.Close(id);
+
+                auto x = Map.X(id);
+
+                auto y = Map.Y(id);
+
+                auto visit = [&](int next, int step, int dx, int dy)
+                {
+                    auto cost = Context.Costs[id] + step;
+
+                    auto distance = cost + AStar::Distance<Connectivity>(x + dx, y + dy, X, Y) * Minimum;
+
+                    if (!Context.Seen(next))
+                    {
+                        Context.See(next);
+
+                        Context.Costs[next] = cost;
+
+                        Context.Parents[next] = id;
+
+                        Context.Open.Push(next, distance);
+                    }
+                    else if (!Context.IsClosed(next) && cost < Context.Costs[next])
+                    {
+                        Context.Costs[next] = cost;
+
+                        Context.Parents[next] = id;
+
+                        Context.Open.Decrease(next, distance);
+                    }
+                    else
+                    {
+                        return;
+                    }
+
+                    if (Track)
+                    {
+                        Touched.push_back(next);
+                    }
+
+                    if (other != nullptr)
+                    {
+                        Meet(next, *other, best);
+                    }
+                };
+
+                AStar::Expand<Connectivity, Corners, Weighted, Reverse>(Map, id, visit);
+            }
+
+            // Check if tile is a better meeting point with the search in the opposite direction
+            void Meet(int tile, AStar::SearchContext &other, AStar::Bidirectional::Meeting &best)
+            {
+                if (other.Seen(tile) && Context.Costs[tile] + other.Costs[tile] < best.Cost)
+                {
+                    best.Cost = Context.Costs[tile] + other.Costs[tile];
+
+                    best.Tile = tile;
+                }
+            }
+
+        private:
+            AStar::Grid &Map;
+
+            // Coordinates of the tile this search is heading to
+            int X;
+
+            int Y;
+
+            // Lowest weight on the grid (see Search)
+            int Minimum;
+        };
+
+        // Lets two threads wait for each other. The last one to arrive runs a function before both carry on.
+        class Barrier
+        {
+        public:
+            template <typename F>
+            void Wait(F last)
+            {
+                std::unique_lock<std::mutex> lock(Lock);
+
+                auto generation = Generation;
+
+                if (++Waiting == 2)
+                {
+                    last();
+
+                    Waiting = 0;
+
+                    Generation++;
+
+                    Wake.notify_all();
+                }
+                else
+                {
+                    Wake.wait(lock, [&]
+                              { return Generation != generation; });
+                }
+            }
+
+        private:
+            std::mutex Lock;
+
+            std::condition_variable Wake;
+
+            int Waiting = 0;
+
+            int Generation = 0;
+        };
+
+        // Number of nodes each thread expands before the threads compare their progress
+        const int Round = 256;
+
+        template <int Connectivity, AStar::Corners Corners, bool Weighted>
+        AStar::Path &Search(AStar::Grid &grid, int src, int dst, AStar::SearchContext &forward, AStar::SearchContext &backward, bool threads)
+        {
+            auto head = AStar::Bidirectional::Frontier<Connectivity, Corners, Weighted, false>(grid, forward, src, dst);
+
+            auto tail = AStar::Bidirectional::Frontier<Connectivity, Corners, Weighted, true>(grid, backward, dst, src);
+
+            auto best = AStar::Bidirectional::Meeting();
+
+            if (src == dst)
+            {
+                best.Cost = 0;
+
+                best.Tile = src;
+            }
+
+            if (!threads)
+            {
+                // Expand the smaller of the two open lists
+                while (head.Top() < best.Cost && tail.Top() < best.Cost)
+                {
+                    if (forward.Open.Size() <= backward.Open.Size())
+                    {
+                        head.Expand(&backward, best);
+                    }
+                    else
+                    {
+                        tail.Expand(&forward, best);
+                    }
+                }
+            }
+            else
+            {
+                // Each thread expands its own search for a round without looking at the other one. Then both
+                // check the tiles they have improved against the other search and decide whether to stop.
+                auto barrier = AStar::Bidirectional::Barrier();
+
+                AStar::Bidirectional::Meeting found[2];
+
+                int tops[2];
+
+                auto done = false;
+
+                auto run = [&](auto &self, AStar::SearchContext &other, int side)
+                {
+                    self.Track = true;
+
+                    while (true)
+                    {
+                        auto limit = best.Cost;
+
+                        for (auto i = 0; i < AStar::Bidirectional::Round && self.Top() < limit; i++)
+                        {
+                            self.Expand(nullptr, found[side]);
+                        }
+
+                        barrier.Wait([] {});
+
+                        for (auto tile : self.Touched)
+                        {
+                            self.Meet(tile, other, found[side]);
+                        }
+
+                        self.Touched.clear();
+
+                        tops[side] = self.Top();
+
+                        barrier.Wait([&]
+                                     {
+                                         for (auto &meeting : found)
+                                         {
+                                             if (meeting.Cost < best.Cost)
+                                             {
+                                                 best = meeting;
+                                             }
+                                         }
+
+                                         done = tops[0] >= best.Cost || tops[1] >= best.Cost; });
+
+                        if (done)
+                        {
+                            break;
+                        }
+                    }
+                };
+
+                auto helper = std::thread([&]
+                                          { run(tail, forward, 1); });
+
+                run(head, backward, 0);
+
+                helper.join();
+            }
+
+            auto &path = forward.Path;
+
+            if (best.Tile < 0)
+            {
+                return path;
+            }
+
+            // From src to the meeting point
+            for (auto node = (std::uint32_t)best.Tile; node != AStar::None; node = forward.Parents[node])
+            {
+                path.Points.push_back(AStar::Point(grid.X(node), grid.Y(node)));
+            }
+
+            std::reverse(path.Points.begin(), path.Points.end());
+
+            // and on to dst
+            for (auto node = backward.Parents[best.Tile]; node != AStar::None; node = backward.Parents[node])
+            {
+                path.Points.push_back(AStar::Point(grid.X(node), grid.Y(node)));
+            }
+
+            return path;
+        }
+
+        // Find path from tile src to tile dst (see Grid::Index) using bidirectional A*, with the same
+        // options as AStar::FindPath. Each direction needs its own context; the path is kept in forward.
+        //
+        // If threads is set, the two searches run on two threads. This only pays off for long searches.
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        AStar::Path &FindPath(AStar::Grid &grid, int src, int dst, AStar::SearchContext &forward, AStar::SearchContext &backward, bool threads = false)
+        {
+            static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+            if (src < 0 || dst < 0)
+            {
+                forward.Path.Points.clear();
+
+                return forward.Path;
+            }
+
+            if (grid.IsWeighted())
+            {
+                return AStar::Bidirectional::Search<Connectivity, Corners, true>(grid, src, dst, forward, backward, threads);
+            }
+
+            return AStar::Bidirectional::Search<Connectivity, Corners, false>(grid, src, dst, forward, backward, threads);
+        }
+
+        // Find path from src to dst using bidirectional A*
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        AStar::Path &FindPath(AStar::Grid &grid, const char src, const char dst, AStar::SearchContext &forward, AStar::SearchContext &backward, bool threads = false)
+        {
+            return AStar::Bidirectional::FindPath<Connectivity, Corners>(grid, grid.Find(src), grid.Find(dst), forward, backward, threads);
+        }
+
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        AStar::Path FindPath(std::vector<std::string> &map, const char src, const char dst, const char passable, bool threads = false)
+        {
+            auto grid = AStar::Grid(map, passable, std::string({src, dst}));
+
+            auto forward = AStar::SearchContext();
+
+            auto backward = AStar::SearchContext();
+
+            return AStar::Bidirectional::FindPath<Connectivity, Corners>(grid, src, dst, forward, backward, threads);
+        }
+    }
+}
+#endif
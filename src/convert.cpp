@@ -0,0 +1,114 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "tiled.hpp"
+
+// Convert a map from its text format (see examples/) to the binary format astar.exe maps straight into
+// memory (see Grid::Save) or, for .tiles files, to chunks astarv2.exe reads as it needs them (see
+// Tiled::Store), for maps too large to keep in memory
+//
+// Usage: convert.exe map.txt map.grid|map.tiles [--terrain costs]
+//
+// Only ' ' can be traversed unless --terrain gives the cost of stepping onto each symbol (see Terrain), as
+// symbol=cost pairs separated by commas, e.g. " =1,~=3,^=8". Tiles cost 1 to 255; other costs are clamped.
+
+// Helper function to read costs given as symbol=cost pairs separated by commas
+bool Parse(const std::string &costs, AStar::Terrain &terrain)
+{
+    terrain = AStar::Terrain();
+
+    auto i = 0;
+
+    while (i < (int)costs.size())
+    {
+        auto symbol = costs[i];
+
+        auto end = costs.find(',', i + 2);
+
+        if (end == std::string::npos)
+        {
+            end = costs.size();
+        }
+
+        if (i + 2 >= (int)end || costs[i + 1] != '=' || costs.find_first_not_of("0123456789", i + 2) < end)
+        {
+            return false;
+        }
+
+        terrain.Set(symbol, std::atoi(costs.substr(i + 2, end - i - 2).c_str()));
+
+        i = end + 1;
+    }
+
+    return terrain.Minimum() > 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char passable = ' ';
+
+    auto terrain = AStar::Terrain(passable);
+
+    auto ok = argc == 3 || (argc == 5 && std::string(argv[3]) == "--terrain" && Parse(argv[4], terrain));
+
+    if (!ok)
+    {
+        std::cout << "Usage: " << argv[0] << " map.txt map.grid|map.tiles [--terrain \" =1,~=3,^=8\"]" << std::endl;
+
+        return 1;
+    }
+
+    // Symbols whose locations are kept, so they can be found without scanning the map
+    const std::string symbols = "AB";
+
+    auto output = std::string(argv[2]);
+
+    if (output.size() > 6 && output.substr(output.size() - 6) == ".tiles")
+    {
+        // Streamed from the text file, which may be too large to read into memory
+        auto store = AStar::Tiled::Store();
+
+        if (!AStar::Tiled::Store::Write(argv[1], output, terrain, symbols) || !store.Open(output))
+        {
+            std::cout << "Cannot convert " << argv[1] << " to " << output << std::endl;
+
+            return 1;
+        }
+
+        std::cout << output << ": " << store.Width << " x " << store.Height << std::endl;
+
+        return 0;
+    }
+
+    auto map = std::vector<std::string>();
+
+    std::string str;
+
+    std::ifstream file(argv[1]);
+
+    if (!file)
+    {
+        std::cout << "Cannot read " << argv[1] << std::endl;
+
+        return 1;
+    }
+
+    while (std::getline(file, str))
+    {
+        map.push_back(str);
+    }
+
+    auto grid = AStar::Grid(map, terrain, symbols);
+
+    if (!grid.Save(argv[2]))
+    {
+        std::cout << "Cannot write " << argv[2] << std::endl;
+
+        return 1;
+    }
+
+    std::cout << argv[2] << ": " << grid.Width << " x " << grid.Height << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,368 @@
+#ifndef __DSTAR_HPP__
+#define __DSTAR_HPP__
+
+#include <climits>
+#include <utility>
+
+#include "astarv2.hpp"
+
+// D* Lite (Koenig and Likhachev): incremental replanning for maps that change between queries.
+//
+// The search runs backwards from dst and keeps what it has found (the cost of reaching dst from every
+// tile it has expanded) from one query to the next. When tiles change, only the tiles whose cost is
+// affected by the change are expanded again, so replanning after opening a door costs about as much as
+// the part of the map the door changes the paths of. src may also move (e.g. as an agent walks along the
+// path) without starting over.
+namespace AStar
+{
+    namespace DStar
+    {
+        // Cost of a tile that cannot reach dst (or is not known to yet)
+        const int Infinity = INT_MAX;
+
+        // Open list keys: (lowest cost plus distance to src, lowest cost), compared lexicographically
+        typedef std::pair<int, int> Key;
+
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        class Planner
+        {
+        public:
+            // Path found by the last call to FindPath
+            AStar::Path Path;
+
+            // Number of tiles expanded by the last call to FindPath
+            int Expanded = 0;
+
+            // Plan paths from tile src to tile dst (see Grid::Index) on grid. The grid is kept by reference
+            // and every change made to it must be passed on to Update (or made through Set).
+            Planner(AStar::Grid &grid, int src, int dst) : Map(grid), Src(src), Dst(dst), Last(src)
+            {
+                static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+                Minimum = Map.IsWeighted() ? Map.MinimumWeight : 1;
+
+                Costs.assign(Map.Size(), AStar::DStar::Infinity);
+
+                Lookahead.assign(Map.Size(), AStar::DStar::Infinity);
+
+                Open.Reset(Map.Size());
+
+                for (auto id = 0; id < Map.Size(); id++)
+                {
+                    Open.Forget(id);
+                }
+
+                if (Dst >= 0)
+                {
+                    Refresh(Dst);
+                }
+            }
+
+            // Plan paths from src to dst
+            Planner(AStar::Grid &grid, const char src, const char dst) : Planner(grid, grid.Find(src), grid.Find(dst))
+            {
+            }
+
+            // Move src to another tile, e.g. the next tile on the path
+            void Move(int src)
+            {
+                if (Last >= 0 && src >= 0)
+                {
+                    Offset += Heuristic(Last, src);
+                }
+
+                Src = src;
+
+                Last = src;
+            }
+
+            // Change whether the tile at (x, y) can be traversed and its weight (see Grid::Set)
+            void Set(int x, int y, bool passable, int weight = 0)
+            {
+                Map.Set(x, y, passable, weight);
+
+                Update(x, y);
+            }
+
+            // Tile at (x, y) has changed in the grid (whether it can be traversed or its weight)
+            void Update(int x, int y)
+            {
+                if (!Map.Contains(x, y))
+                {
+                    return;
+                }
+
+                // A lower weight than any before makes the keys on the open list overestimate
+                if (Map.IsWeighted() && Map.MinimumWeight < Minimum)
+                {
+                    Rekey();
+                }
+
+                auto id = Map.Index(x, y);
+
+                Refresh(id);
+
+                // Steps onto, off and (diagonally) past the tile
+                for (auto i = 0; i < Connectivity; i++)
+                {
+                    Refresh(id + AStar::Neighbors[i][0] + AStar::Neighbors[i][1] * Map.Stride);
+                }
+            }
+
+            // Tiles that have changed in the grid
+            void Update(const std::vector<AStar::Point> &changed)
+            {
+                for (auto &point : changed)
+                {
+                    Update(point.X, point.Y);
+                }
+            }
+
+            // Find path from src to dst, only searching again where the grid has changed since the last call
+            AStar::Path &FindPath()
+            {
+                Path.Points.clear();
+
+                Expanded = 0;
+
+                if (Src < 0 || Dst < 0)
+                {
+                    return Path;
+                }
+
+                if (Map.IsWeighted())
+                {
+                    Search<true>();
+                }
+                else
+                {
+                    Search<false>();
+                }
+
+                // The search may stop before expanding src itself, so its cost is the one through its neighbours
+                if (Lookahead[Src] == AStar::DStar::Infinity)
+                {
+                    return Path;
+                }
+
+                // Every tile on the way knows the cost of reaching dst, so take the cheapest step each time
+                auto node = Src;
+
+                Path.Points.push_back(AStar::Point(Map.X(node), Map.Y(node)));
+
+                while (node != Dst && (int)Path.Points.size() <= Map.Size())
+                {
+                    auto best = AStar::DStar::Infinity;
+
+                    auto next = -1;
+
+                    auto visit = [&](int tile, int step, int, int)
+                    {
+                        if (Costs[tile] != AStar::DStar::Infinity && step + Costs[tile] < best)
+                        {
+                            best = step + Costs[tile];
+
+                            next = tile;
+                        }
+                    };
+
+                    Step<false>(node, visit);
+
+                    if (next < 0)
+                    {
+                        Path.Points.clear();
+
+                        return Path;
+                    }
+
+                    node = next;
+
+                    Path.Points.push_back(AStar::Point(Map.X(node), Map.Y(node)));
+                }
+
+                // Went round in circles without reaching dst
+                if (node != Dst)
+                {
+                    Path.Points.clear();
+                }
+
+                return Path;
+            }
+
+        private:
+            AStar::Grid &Map;
+
+            int Src;
+
+            int Dst;
+
+            // src when Offset was last raised
+            int Last;
+
+            // Sum of the distances src has moved, added to new keys instead of rekeying the open list
+            int Offset = 0;
+
+            // Lowest weight on the grid (see AStar::Search)
+            int Minimum;
+
+            // Cost of reaching dst from each tile, as last expanded
+            std::vector<int> Costs;
+
+            // Cost of reaching dst from each tile through its cheapest neighbour (Costs once expanded)
+            std::vector<int> Lookahead;
+
+            // Tiles whose Costs and Lookahead differ
+            AStar::Heap<AStar::DStar::Key> Open;
+
+            int Heuristic(int a, int b)
+            {
+                return AStar::Distance<Connectivity>(Map.X(a), Map.Y(a), Map.X(b), Map.Y(b)) * Minimum;
+            }
+
+            // Key the open list again for the lowest weight on the grid, from src as it is now
+            void Rekey()
+            {
+                Minimum = Map.MinimumWeight;
+
+                Offset = 0;
+
+                Last = Src;
+
+                for (auto id = 0; id < Map.Size(); id++)
+                {
+                    if (Open.Contains(id))
+                    {
+                        Open.Update(id, Priority(id));
+                    }
+                }
+            }
+
+            AStar::DStar::Key Priority(int id)
+            {
+                auto cost = std::min(Costs[id], Lookahead[id]);
+
+                if (cost == AStar::DStar::Infinity)
+                {
+                    return {AStar::DStar::Infinity, AStar::DStar::Infinity};
+                }
+
+                return {cost + Heuristic(Src, id) + Offset, cost};
+            }
+
+            // Call visit(next, step, dx, dy) for each tile next that can be reached from id in one step (or, if
+            // Reverse, that can reach id in one step, where step is the cost of that step)
+            template <bool Reverse, typename F>
+            void Step(int id, F visit)
+            {
+                if (Map.IsWeighted())
+                {
+                    AStar::Expand<Connectivity, Corners, true, Reverse>(Map, id, visit);
+                }
+                else
+                {
+                    AStar::Expand<Connectivity, Corners, false, Reverse>(Map, id, visit);
+                }
+            }
+
+            // Work out Lookahead of a tile again and put it on (or take it off) the open list accordingly
+            void Refresh(int id)
+            {
+                auto best = AStar::DStar::Infinity;
+
+                if (id == Dst && Map.IsPassable(id))
+                {
+                    best = 0;
+                }
+                else if (Map.IsPassable(id))
+                {
+                    auto visit = [&](int next, int step, int, int)
+                    {
+                        if (Costs[next] != AStar::DStar::Infinity)
+                        {
+                            best = std::min(best, step + Costs[next]);
+                        }
+                    };
+
+                    Step<false>(id, visit);
+                }
+
+                Lookahead[id] = best;
+
+                Queue(id);
+            }
+
+            void Queue(int id)
+            {
+                if (Costs[id] == Lookahead[id])
+                {
+                    if (Open.Contains(id))
+                    {
+                        Open.Remove(id);
+                    }
+                }
+                else if (Open.Contains(id))
+                {
+                    Open.Update(id, Priority(id));
+                }
+                else
+                {
+                    Open.Push(id, Priority(id));
+                }
+            }
+
+            // Expand tiles until src has its lowest cost and nothing on the open list can lower it
+            template <bool Weighted>
+            void Search()
+            {
+                while (!Open.Empty() && (Open.Key(Open.Top()) < Priority(Src) || Lookahead[Src] > Costs[Src]))
+                {
+                    auto id = Open.Top();
+
+                    auto key = Priority(id);
+
+                    Expanded++;
+
+                    if (Open.Key(id) < key)
+                    {
+                        // Keyed before src moved
+                        Open.Update(id, key);
+                    }
+                    else if (Costs[id] > Lookahead[id])
+                    {
+                        // Cheaper than before: pass the new cost on to the tiles that can step onto this one
+                        Costs[id] = Lookahead[id];
+
+                        Open.Remove(id);
+
+                        auto visit = [&](int next, int step, int, int)
+                        {
+                            if (step + Costs[id] < Lookahead[next])
+                            {
+                                Lookahead[next] = step + Costs[id];
+
+                                Queue(next);
+                            }
+                        };
+
+                        AStar::Expand<Connectivity, Corners, Weighted, true>(Map, id, visit);
+                    }
+                    else
+                    {
+                        // Dearer than before (e.g. the way through has been blocked): work everything out again
+                        Costs[id] = AStar::DStar::Infinity;
+
+                        Refresh(id);
+
+                        auto visit = [&](int next, int, int, int)
+                        {
+                            Refresh(next);
+                        };
+
+                        AStar::Expand<Connectivity, Corners, Weighted, true>(Map, id, visit);
+                    }
+                }
+            }
+        };
+    }
+}
+#endif
@@ -0,0 +1,325 @@
+#ifndef __FLOWFIELD_HPP__
+#define __FLOWFIELD_HPP__
+
+#include <atomic>
+#include <cassert>
+#include <climits>
+
+#include "batch.hpp"
+
+// Flow fields, for crowds of agents that all head for the same goals: the cost of the cheapest path from
+// every tile to the nearest goal, and the direction of the first step of that path. Once a field is built,
+// every agent finds its next step with a lookup (see Next) instead of a search.
+//
+// A field is built by Dijkstra's algorithm backwards from all the goals at once, with the open list kept
+// as buckets of tiles by cost (Dial's algorithm): steps cost small whole numbers, so the costs waiting to
+// be expanded never span more than the most expensive step. Every step costs at least 1, so the tiles of
+// the cheapest bucket cannot lower each other's costs and are expanded together as one wavefront, split
+// between threads when it is large enough. On 4-connected grids without weights this is a breadth-first
+// search, one bucket per step away from the goals.
+namespace AStar
+{
+    class FlowField
+    {
+    public:
+        // Distance of tiles from which no goal can be reached
+        static constexpr std::int32_t Unreachable = INT32_MAX;
+
+        // Direction of goals and of tiles from which no goal can be reached
+        static constexpr std::uint8_t None = 255;
+
+        // Dimensions of the map the field was built for
+        int Width = 0;
+
+        int Height = 0;
+
+        // Cost of the cheapest path from each tile (at y * Width + x) to the nearest goal
+        std::vector<std::int32_t> Distances;
+
+        // First step of that path from each tile, as an index into Neighbors
+        std::vector<std::uint8_t> Directions;
+
+        // Wavefronts of at least Parallel tiles are split between the given number of threads (see Batch)
+        FlowField(int threads = std::thread::hardware_concurrency()) : Workers(threads)
+        {
+        }
+
+        // Build the field towards the given goal tiles (see Grid::Index), with the same Connectivity,
+        // Corners and costs as FindPath
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        void Build(AStar::Grid &grid, const std::vector<int> &goals)
+        {
+            static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+            // A step of cost 0 would land in the bucket being expanded, after it was taken (see Flood)
+            assert(!grid.IsWeighted() || grid.MinimumWeight >= 1);
+
+            if (grid.IsWeighted())
+            {
+                Flood<Connectivity, Corners, true>(grid, goals);
+            }
+            else
+            {
+                Flood<Connectivity, Corners, false>(grid, goals);
+            }
+        }
+
+        // Build the field towards every tile marked with goal (see Grid::Locate)
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        void Build(AStar::Grid &grid, const char goal)
+        {
+            Build<Connectivity, Corners>(grid, grid.Locate(goal));
+        }
+
+        int Distance(int x, int y)
+        {
+            return Distances[(std::size_t)y * Width + x];
+        }
+
+        // Next tile on the way from (x, y) to the nearest goal ((x, y) itself at a goal or if no goal can
+        // be reached)
+        AStar::Point Next(int x, int y)
+        {
+            auto direction = Directions[(std::size_t)y * Width + x];
+
+            if (direction == None)
+            {
+                return AStar::Point(x, y);
+            }
+
+            return AStar::Point(x + AStar::Neighbors[direction][0], y + AStar::Neighbors[direction][1]);
+        }
+
+        // Smallest wavefront split between threads
+        int Parallel = 4096;
+
+    private:
+        AStar::Batch Workers;
+
+        // Cost of each tile (see Grid::Index) while the field is built, lowered by any thread
+        std::unique_ptr<std::atomic<std::int32_t>[]> Costs;
+
+        int Size = 0;
+
+        // Tiles waiting to be expanded, by cost: tiles reached at cost c are in Buckets[c % Buckets.size()]
+        std::vector<std::vector<int>> Buckets;
+
+        // Tiles reached by each thread, with their costs
+        std::vector<std::vector<std::pair<int, int>>> Reached;
+
+        // Lower the cost of every tile that reaches tile id in one step, given the cost of id, and call
+        // reached(next, cost) for each one that got cheaper. Only Shared costs may be lowered by other
+        // threads at the same time.
+        template <int Connectivity, AStar::Corners Corners, bool Weighted, bool Shared, typename F>
+        void Relax(AStar::Grid &grid, int id, int cost, F reached)
+        {
+            auto visit = [&](int next, int step, int, int)
+            {
+                auto total = cost + step;
+
+                auto current = Costs[next].load(std::memory_order_relaxed);
+
+                if (!Shared)
+                {
+                    if (total < current)
+                    {
+                        Costs[next].store(total, std::memory_order_relaxed);
+
+                        reached(next, total);
+                    }
+
+                    return;
+                }
+
+                while (total < current)
+                {
+                    if (Costs[next].compare_exchange_weak(current, total, std::memory_order_relaxed))
+                    {
+                        reached(next, total);
+
+                        break;
+                    }
+                }
+            };
+
+            AStar::Expand<Connectivity, Corners, Weighted, true>(grid, id, visit);
+        }
+
+        template <int Connectivity, AStar::Corners Corners, bool Weighted>
+        void Flood(AStar::Grid &grid, const std::vector<int> &goals)
+        {
+            if (grid.Size() > Size)
+            {
+                Size = grid.Size();
+
+                Costs.reset(new std::atomic<std::int32_t>[Size]);
+            }
+
+            for (auto i = 0; i < grid.Size(); i++)
+            {
+                Costs[i].store(Unreachable, std::memory_order_relaxed);
+            }
+
+            // Costs waiting to be expanded span at most the most expensive step
+            auto most = (Connectivity == 8 ? AStar::Diagonal : 1) * (Weighted ? 255 : 1);
+
+            Buckets.resize(most + 1);
+
+            for (auto &bucket : Buckets)
+            {
+                bucket.clear();
+            }
+
+            auto count = (int)Buckets.size();
+
+            auto pending = 0LL;
+
+            for (auto goal : goals)
+            {
+                if (goal >= 0 && goal < grid.Size() && grid.IsPassable(goal) && Costs[goal].load(std::memory_order_relaxed) != 0)
+                {
+                    Costs[goal].store(0, std::memory_order_relaxed);
+
+                    Buckets[0].push_back(goal);
+
+                    pending++;
+                }
+            }
+
+            auto wavefront = std::vector<int>();
+
+            for (auto cost = 0; pending > 0; cost++)
+            {
+                auto &bucket = Buckets[cost % count];
+
+                if (bucket.empty())
+                {
+                    continue;
+                }
+
+                wavefront.swap(bucket);
+
+                bucket.clear();
+
+                pending -= wavefront.size();
+
+                auto threads = Workers.Threads();
+
+                if ((int)wavefront.size() < Parallel || threads == 1)
+                {
+                    auto push = [&](int next, int total)
+                    {
+                        Buckets[total % count].push_back(next);
+
+                        pending++;
+                    };
+
+                    for (auto id : wavefront)
+                    {
+                        // Tiles that got cheaper after they were put in the bucket were expanded already
+                        if (Costs[id].load(std::memory_order_relaxed) != cost)
+                        {
+                            continue;
+                        }
+
+                        Relax<Connectivity, Corners, Weighted, false>(grid, id, cost, push);
+                    }
+
+                    continue;
+                }
+
+                Reached.resize(threads);
+
+                Workers.Run(threads, [&](int i, AStar::SearchContext &)
+                            {
+                                auto &reached = Reached[i];
+
+                                reached.clear();
+
+                                auto push = [&](int next, int total)
+                                {
+                                    reached.push_back({next, total});
+                                };
+
+                                auto end = wavefront.size() * (i + 1) / threads;
+
+                                for (auto j = wavefront.size() * i / threads; j < end; j++)
+                                {
+                                    auto id = wavefront[j];
+
+                                    if (Costs[id].load(std::memory_order_relaxed) != cost)
+                                    {
+                                        continue;
+                                    }
+
+                                    Relax<Connectivity, Corners, Weighted, true>(grid, id, cost, push);
+                                } });
+
+                // A tile made cheaper by two threads is in two buckets, but only expanded from the cheaper
+                for (auto &reached : Reached)
+                {
+                    for (auto &tile : reached)
+                    {
+                        Buckets[tile.second % count].push_back(tile.first);
+                    }
+
+                    pending += reached.size();
+                }
+            }
+
+            Width = grid.Width;
+
+            Height = grid.Height;
+
+            Distances.resize((std::size_t)Width * Height);
+
+            Directions.resize((std::size_t)Width * Height);
+
+            // The first step from a tile is to a neighbor whose cost plus the step is the cost of the tile
+            Workers.Run(Height, [&](int y, AStar::SearchContext &)
+                        {
+                            for (auto x = 0; x < Width; x++)
+                            {
+                                auto id = grid.Index(x, y);
+
+                                auto at = (std::size_t)y * Width + x;
+
+                                auto cost = Costs[id].load(std::memory_order_relaxed);
+
+                                Distances[at] = cost;
+
+                                Directions[at] = None;
+
+                                if (cost == 0 || cost == Unreachable)
+                                {
+                                    continue;
+                                }
+
+                                auto visit = [&](int next, int step, int dx, int dy)
+                                {
+                                    if (Directions[at] == None && (long long)Costs[next].load(std::memory_order_relaxed) + step == cost)
+                                    {
+                                        Directions[at] = Direction(dx, dy);
+                                    }
+                                };
+
+                                AStar::Expand<Connectivity, Corners, Weighted>(grid, id, visit);
+                            } });
+        }
+
+        // Index into Neighbors of a step
+        static std::uint8_t Direction(int dx, int dy)
+        {
+            for (auto i = 0; i < 8; i++)
+            {
+                if (AStar::Neighbors[i][0] == dx && AStar::Neighbors[i][1] == dy)
+                {
+                    return i;
+                }
+            }
+
+            return None;
+        }
+    };
+}
+#endif
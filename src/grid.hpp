@@ -0,0 +1,751 @@
+#ifndef __GRID_HPP__
+#define __GRID_HPP__
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace AStar
+{
+    // Cost of stepping onto a tile marked with a given symbol (0 if such tiles cannot be traversed)
+    class Terrain
+    {
+    public:
+        std::array<std::uint8_t, 256> Costs = {};
+
+        Terrain()
+        {
+        }
+
+        // Only tiles marked with passable can be traversed, each step costs 1
+        Terrain(const char passable)
+        {
+            Set(passable, 1);
+        }
+
+        // Terrain from a list of symbols and their costs, e.g. {{' ', 1}, {'~', 3}, {'^', 8}}
+        Terrain(std::initializer_list<std::pair<char, int>> costs)
+        {
+            for (auto &cost : costs)
+            {
+                Set(cost.first, cost.second);
+            }
+        }
+
+        // Set cost (0 to 255) of stepping onto tiles marked with c
+        void Set(const char c, int cost)
+        {
+            Costs[(unsigned char)c] = std::min(std::max(cost, 0), 255);
+        }
+
+        int Cost(const char c) const
+        {
+            return Costs[(unsigned char)c];
+        }
+
+        // Lowest cost of stepping onto a tile that can be traversed (0 if there is none)
+        int Minimum() const
+        {
+            auto minimum = 0;
+
+            for (auto cost : Costs)
+            {
+                if (cost > 0 && (minimum == 0 || cost < minimum))
+                {
+                    minimum = cost;
+                }
+            }
+
+            return minimum;
+        }
+
+        // Check if every tile that can be traversed costs 1
+        bool IsUniform() const
+        {
+            for (auto cost : Costs)
+            {
+                if (cost > 1)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+
+    // Array of T that either owns its elements or uses memory it does not own (e.g. a mapped file, see
+    // Grid::Load). Offers the parts of std::vector the grid needs.
+    template <typename T>
+    class Buffer
+    {
+    public:
+        Buffer()
+        {
+        }
+
+        Buffer(const Buffer &other)
+        {
+            *this = other;
+        }
+
+        // Copies own their elements, whoever owns the original ones
+        Buffer &operator=(const Buffer &other)
+        {
+            if (this != &other)
+            {
+                Owned.assign(other.Data, other.Data + other.Count);
+
+                Data = Owned.data();
+
+                Count = other.Count;
+            }
+
+            return *this;
+        }
+
+        Buffer(Buffer &&other)
+        {
+            *this = std::move(other);
+        }
+
+        Buffer &operator=(Buffer &&other)
+        {
+            if (this != &other)
+            {
+                auto owned = other.Data == other.Owned.data();
+
+                Owned = std::move(other.Owned);
+
+                Data = owned ? Owned.data() : other.Data;
+
+                Count = other.Count;
+
+                other.clear();
+            }
+
+            return *this;
+        }
+
+        T &operator[](std::size_t i)
+        {
+            return Data[i];
+        }
+
+        const T &operator[](std::size_t i) const
+        {
+            return Data[i];
+        }
+
+        std::size_t size() const
+        {
+            return Count;
+        }
+
+        bool empty() const
+        {
+            return Count == 0;
+        }
+
+        T *data()
+        {
+            return Data;
+        }
+
+        T *begin()
+        {
+            return Data;
+        }
+
+        T *end()
+        {
+            return Data + Count;
+        }
+
+        // Own count copies of value
+        void assign(std::size_t count, const T &value)
+        {
+            Owned.assign(count, value);
+
+            Data = Owned.data();
+
+            Count = count;
+        }
+
+        void clear()
+        {
+            Owned.clear();
+
+            Data = nullptr;
+
+            Count = 0;
+        }
+
+        // Use count elements at data, which must outlive the buffer
+        void Use(T *data, std::size_t count)
+        {
+            Owned.clear();
+
+            Data = data;
+
+            Count = count;
+        }
+
+    private:
+        std::vector<T> Owned;
+
+        T *Data = nullptr;
+
+        std::size_t Count = 0;
+    };
+
+    // Compact representation of the environment, built once from its string representation.
+    //
+    // Passability is kept as a bitmap, one row after another. Every row is surrounded by a border of
+    // blocked tiles (and padded to a multiple of 64 tiles) and there is a blocked row above and below
+    // the map, so moving from any tile on the map never needs a bounds check. A transposed copy of the
+    // bitmap (one column after another) lets columns be scanned 64 tiles at a time as well as rows.
+    //
+    // Tiles with different costs (see Terrain) also have their cost kept in a byte per tile.
+    //
+    // Tiles are identified by their index in the bitmap (see Index).
+    //
+    // A grid can also be saved to a binary file (see Save) and mapped back into memory (see Load), which
+    // is much faster than building it, as the file already holds the bitmaps and only needs to be checked.
+    class Grid
+    {
+    public:
+        // Dimensions of the map (without the border)
+        int Width = 0;
+
+        int Height = 0;
+
+        // Number of tiles in a row (with the border and padding)
+        int Stride = 0;
+
+        // Number of tiles in a column of the transposed bitmap (with the border and padding)
+        int ColumnStride = 0;
+
+        // Passability bitmap
+        AStar::Buffer<std::uint64_t> Bits;
+
+        // Transposed passability bitmap
+        AStar::Buffer<std::uint64_t> Columns;
+
+        // Cost of stepping onto each tile (empty if every step costs 1)
+        AStar::Buffer<std::uint8_t> Weights;
+
+        // Lowest cost of stepping onto a tile
+        int MinimumWeight = 1;
+
+        Grid()
+        {
+        }
+
+        // Create a grid of the given dimensions where no tile can be traversed
+        Grid(int width, int height)
+        {
+            Allocate(width, height);
+        }
+
+        // Build grid from map. Tiles marked with passable or with one of the symbols can be traversed.
+        // Locations of the symbols are indexed so they can be found without scanning the map.
+        Grid(std::vector<std::string> &map, const char passable, const std::string &symbols) : Grid(map, AStar::Terrain(passable), symbols)
+        {
+        }
+
+        // Build grid from map with the cost of each tile given by terrain. Tiles marked with one of the
+        // symbols can also be traversed, at their cost in terrain if it has one or the lowest cost otherwise.
+        Grid(std::vector<std::string> &map, const AStar::Terrain &terrain, const std::string &symbols)
+        {
+            auto width = 0;
+
+            for (auto &row : map)
+            {
+                width = std::max(width, (int)row.length());
+            }
+
+            Allocate(width, map.size());
+
+            MinimumWeight = std::max(terrain.Minimum(), 1);
+
+            if (!terrain.IsUniform())
+            {
+                Weights.assign(Size(), 0);
+            }
+
+            std::array<bool, 256> indexed = {};
+
+            for (auto c : symbols)
+            {
+                indexed[(unsigned char)c] = true;
+            }
+
+            for (auto y = 0; y < Height; y++)
+            {
+                for (auto x = 0; x < (int)map[y].length(); x++)
+                {
+                    auto c = (unsigned char)map[y][x];
+
+                    if (indexed[c])
+                    {
+                        Symbols[c].push_back(Index(x, y));
+                    }
+
+                    auto cost = terrain.Costs[c];
+
+                    if (cost == 0 && indexed[c])
+                    {
+                        cost = MinimumWeight;
+                    }
+
+                    if (cost > 0)
+                    {
+                        Set(x, y, true, cost);
+                    }
+                }
+            }
+        }
+
+        // Number of tiles (with the border and padding)
+        int Size()
+        {
+            return Stride * (Height + 2);
+        }
+
+        // Index of the tile at (x, y)
+        int Index(int x, int y)
+        {
+            return (y + 1) * Stride + x + 1;
+        }
+
+        // Coordinates of a tile
+        int X(int id)
+        {
+            return id % Stride - 1;
+        }
+
+        int Y(int id)
+        {
+            return id / Stride - 1;
+        }
+
+        // Check if tile is on the map
+        bool Contains(int x, int y)
+        {
+            return x >= 0 && x < Width && y >= 0 && y < Height;
+        }
+
+        // Tile one step of (dx, dy) away from tile id
+        int Next(int id, int dx, int dy)
+        {
+            return id + dx + dy * Stride;
+        }
+
+        bool IsPassable(int id)
+        {
+            return (Bits[id >> 6] >> (id & 63)) & 1;
+        }
+
+        // Cost of stepping onto a tile of a weighted grid
+        int Weight(int id)
+        {
+            return Weights[id];
+        }
+
+        // Check if steps may cost more than 1 (see Weights)
+        bool IsWeighted()
+        {
+            return !Weights.empty();
+        }
+
+        // Change whether the tile at (x, y) can be traversed and, if it can, the cost (1 to 255) of stepping
+        // onto it. Without a weight, a tile keeps the weight it has or, if it could not be traversed, gets
+        // the lowest weight on the grid. Weights other than 1 make the grid weighted (see Weights).
+        void Set(int x, int y, bool passable, int weight = 0)
+        {
+            auto id = Index(x, y);
+
+            auto column = (x + 1) * ColumnStride + y + 1;
+
+            if (passable)
+            {
+                Bits[id >> 6] |= std::uint64_t(1) << (id & 63);
+
+                Columns[column >> 6] |= std::uint64_t(1) << (column & 63);
+
+                if (weight <= 0)
+                {
+                    weight = IsWeighted() && Weights[id] > 0 ? Weights[id] : MinimumWeight;
+                }
+
+                weight = std::min(weight, 255);
+
+                if (weight != 1 && !IsWeighted())
+                {
+                    Weigh();
+                }
+
+                if (IsWeighted())
+                {
+                    Weights[id] = weight;
+
+                    // Steps must never cost less than the heuristic assumes (see Heuristic)
+                    MinimumWeight = std::min(MinimumWeight, weight);
+                }
+            }
+            else
+            {
+                Bits[id >> 6] &= ~(std::uint64_t(1) << (id & 63));
+
+                Columns[column >> 6] &= ~(std::uint64_t(1) << (column & 63));
+
+                if (IsWeighted())
+                {
+                    Weights[id] = 0;
+                }
+            }
+        }
+
+        // First word of row y (-1 to Height) of the bitmap
+        const std::uint64_t *Row(int y)
+        {
+            return &Bits[(std::size_t)(y + 1) * (Stride / 64)];
+        }
+
+        // First word of column x (-1 to Width) of the transposed bitmap
+        const std::uint64_t *Column(int x)
+        {
+            return &Columns[(std::size_t)(x + 1) * (ColumnStride / 64)];
+        }
+
+        // Index of the first tile marked with symbol c (-1 if there is none)
+        int Find(const char c)
+        {
+            auto &tiles = Symbols[(unsigned char)c];
+
+            return tiles.empty() ? -1 : tiles.front();
+        }
+
+        // All tiles marked with symbol c
+        std::vector<int> &Locate(const char c)
+        {
+            return Symbols[(unsigned char)c];
+        }
+
+        // Write the grid (with the locations of its symbols) to a binary file
+        bool Save(const std::string &filename)
+        {
+            auto file = std::fopen(filename.c_str(), "wb");
+
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            auto markers = std::vector<std::uint32_t>();
+
+            for (auto c = 0; c < 256; c++)
+            {
+                for (auto tile : Symbols[c])
+                {
+                    markers.push_back(c);
+
+                    markers.push_back(tile);
+                }
+            }
+
+            auto header = Header();
+
+            std::memcpy(header.Magic, "GRD1", 4);
+
+            header.Width = Width;
+
+            header.Height = Height;
+
+            header.Stride = Stride;
+
+            header.ColumnStride = ColumnStride;
+
+            header.MinimumWeight = MinimumWeight;
+
+            header.Weighted = IsWeighted();
+
+            header.Markers = markers.size() / 2;
+
+            auto padding = std::vector<char>(Padding(markers.size()), 0);
+
+            auto ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+            // fwrite must not be given the null pointer of an empty vector
+            if (!markers.empty())
+            {
+                ok = ok && std::fwrite(markers.data(), sizeof(std::uint32_t), markers.size(), file) == markers.size();
+            }
+
+            ok = ok && std::fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+
+            ok = ok && std::fwrite(Bits.data(), sizeof(std::uint64_t), Bits.size(), file) == Bits.size();
+
+            ok = ok && std::fwrite(Columns.data(), sizeof(std::uint64_t), Columns.size(), file) == Columns.size();
+
+            // Grids without weights have no buffer to write (and fwrite must not be given a null pointer)
+            if (IsWeighted())
+            {
+                ok = ok && std::fwrite(Weights.data(), 1, Weights.size(), file) == Weights.size();
+            }
+
+            return std::fclose(file) == 0 && ok;
+        }
+
+        // Map a grid written by Save into memory. Changes (see Set) are private to this grid and never
+        // written back. Returns false (and leaves the grid unchanged) if the file is not a grid.
+        //
+        // Searches trust the border to be blocked and every step to cost at least 1, so the bitmaps and
+        // weights are read through once to check them (see Verify) and files that break either are refused.
+        bool Load(const std::string &filename)
+        {
+            auto file = open(filename.c_str(), O_RDONLY);
+
+            if (file < 0)
+            {
+                return false;
+            }
+
+            struct stat status;
+
+            auto length = fstat(file, &status) == 0 ? (std::size_t)status.st_size : 0;
+
+            auto data = length >= sizeof(Header) ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0) : MAP_FAILED;
+
+            close(file);
+
+            if (data == MAP_FAILED)
+            {
+                return false;
+            }
+
+            auto mapping = std::shared_ptr<void>(data, [length](void *data)
+                                                 { munmap(data, length); });
+
+            auto &header = *(const Header *)data;
+
+            auto markers = (const std::uint32_t *)((const char *)data + sizeof(Header));
+
+            // Tiles are numbered with an int (see Size), so both bitmaps must have fewer than 2^31 tiles
+            auto tiles = (std::uint64_t)header.Stride * ((std::uint64_t)header.Height + 2);
+
+            auto transposed = (std::uint64_t)header.ColumnStride * ((std::uint64_t)header.Width + 2);
+
+            if (std::memcmp(header.Magic, "GRD1", 4) != 0 || header.Stride % 64 != 0 || header.ColumnStride % 64 != 0 || header.Stride < (std::uint64_t)header.Width + 2 || header.ColumnStride < (std::uint64_t)header.Height + 2 || tiles > INT_MAX || transposed > INT_MAX)
+            {
+                return false;
+            }
+
+            auto bits = (std::size_t)tiles / 64;
+
+            auto columns = (std::size_t)transposed / 64;
+
+            auto offset = sizeof(Header) + (std::size_t)header.Markers * 2 * sizeof(std::uint32_t);
+
+            offset += Padding((std::size_t)header.Markers * 2);
+
+            auto weights = header.Weighted ? (std::size_t)tiles : 0;
+
+            if (length != offset + (bits + columns) * sizeof(std::uint64_t) + weights)
+            {
+                return false;
+            }
+
+            for (auto i = 0; i < (int)header.Markers; i++)
+            {
+                if (markers[i * 2 + 1] >= tiles)
+                {
+                    return false;
+                }
+            }
+
+            auto base = (char *)data + offset;
+
+            if (!Verify(header, (const std::uint64_t *)base, bits, columns))
+            {
+                return false;
+            }
+
+            Width = header.Width;
+
+            Height = header.Height;
+
+            Stride = header.Stride;
+
+            ColumnStride = header.ColumnStride;
+
+            MinimumWeight = header.MinimumWeight;
+
+            Bits.Use((std::uint64_t *)base, bits);
+
+            Columns.Use((std::uint64_t *)base + bits, columns);
+
+            Weights.Use((std::uint8_t *)((std::uint64_t *)base + bits + columns), weights);
+
+            for (auto &tiles : Symbols)
+            {
+                tiles.clear();
+            }
+
+            for (auto i = 0; i < (int)header.Markers; i++)
+            {
+                Symbols[markers[i * 2] & 255].push_back(markers[i * 2 + 1]);
+            }
+
+            Mapping = mapping;
+
+            return true;
+        }
+
+    private:
+        // Layout of the files written by Save: the header, the locations of the symbols (pairs of symbol
+        // and tile), padding to a multiple of 64 bytes, then Bits, Columns and Weights
+        struct Header
+        {
+            char Magic[4];
+
+            std::uint32_t Width;
+
+            std::uint32_t Height;
+
+            std::uint32_t Stride;
+
+            std::uint32_t ColumnStride;
+
+            std::uint32_t MinimumWeight;
+
+            std::uint32_t Weighted;
+
+            std::uint32_t Markers;
+        };
+
+        // Locations of the symbols
+        std::array<std::vector<int>, 256> Symbols;
+
+        // File the grid was loaded from
+        std::shared_ptr<void> Mapping;
+
+        // Check the bitmaps and weights that follow the header of a file (see Load): only tiles on the map
+        // can be traversed, the transposed bitmap holds the same tiles and, on weighted grids, traversable
+        // tiles cost at least MinimumWeight, which is at least 1
+        static bool Verify(const Header &header, const std::uint64_t *bits, std::size_t count, std::size_t columns)
+        {
+            auto stride = (std::size_t)header.Stride;
+
+            auto weights = (const std::uint8_t *)(bits + count + columns);
+
+            if (header.Weighted && header.MinimumWeight < 1)
+            {
+                return false;
+            }
+
+            auto passable = std::uint64_t(0);
+
+            auto transposed = std::uint64_t(0);
+
+            for (std::size_t i = 0; i < columns; i++)
+            {
+                transposed += __builtin_popcountll(bits[count + i]);
+            }
+
+            for (std::size_t i = 0; i < count; i++)
+            {
+                auto word = bits[i];
+
+                if (word == 0)
+                {
+                    continue;
+                }
+
+                // Tiles of the word in columns 1 to Width of rows 1 to Height, i.e. on the map
+                auto y = i * 64 / stride;
+
+                auto first = i * 64 % stride;
+
+                auto low = std::max<std::size_t>(first, 1);
+
+                auto high = std::min<std::size_t>(first + 63, header.Width);
+
+                auto inside = y < 1 || y > header.Height || low > high ? 0 : (~std::uint64_t(0) >> (63 - (high - low))) << (low - first);
+
+                if (word & ~inside)
+                {
+                    return false;
+                }
+
+                passable += __builtin_popcountll(word);
+
+                for (; word != 0; word &= word - 1)
+                {
+                    auto id = i * 64 + __builtin_ctzll(word);
+
+                    auto column = (id % stride) * header.ColumnStride + y;
+
+                    if (!((bits[count + column / 64] >> (column % 64)) & 1) || (header.Weighted && weights[id] < header.MinimumWeight))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            // Every tile of the bitmap is in the transposed one, so the counts only match without others
+            return passable == transposed;
+        }
+
+        // Bytes of padding after the header and markers (32-bit words) in a file
+        static std::size_t Padding(std::size_t markers)
+        {
+            auto used = sizeof(Header) + markers * sizeof(std::uint32_t);
+
+            return (64 - used % 64) % 64;
+        }
+
+        void Allocate(int width, int height)
+        {
+            Width = width;
+
+            Height = height;
+
+            Stride = ((Width + 2 + 63) / 64) * 64;
+
+            ColumnStride = ((Height + 2 + 63) / 64) * 64;
+
+            Bits.assign((std::size_t)Stride * (Height + 2) / 64, 0);
+
+            Columns.assign((std::size_t)ColumnStride * (Width + 2) / 64, 0);
+        }
+
+        // Give the grid weights, with every tile that can be traversed costing 1
+        void Weigh()
+        {
+            Weights.assign(Size(), 0);
+
+            for (auto id = 0; id < Size(); id++)
+            {
+                if (IsPassable(id))
+                {
+                    Weights[id] = 1;
+                }
+            }
+        }
+    };
+}
+#endif
@@ -0,0 +1,750 @@
+#ifndef __HPA_HPP__
+#define __HPA_HPP__
+
+#include <unordered_map>
+
+#include "astarv2.hpp"
+
+// Hierarchical pathfinding (HPA*) for large maps that rarely change.
+//
+// The map is split into square clusters. Wherever two neighbouring clusters can be crossed between, one
+// tile on each side of their border becomes an entrance, and the cost of travelling between any two
+// entrances of a cluster (without leaving it) is found once. A query then only searches this
+// much smaller graph of entrances and runs A* again inside the clusters its path goes through.
+//
+// With Corners::Cut, clusters may also only meet diagonally, past two blocked tiles (on a border or where
+// four clusters meet), so every such diagonal step becomes a pair of entrances too.
+//
+// Paths are close to the shortest but not always the shortest, as they have to go through entrances.
+namespace AStar
+{
+    namespace HPA
+    {
+        // Entrances of a border open for at least this many tiles get one at each end instead of one in the middle
+        const int Wide = 6;
+
+        // Borders of a cluster with transitions of its own: right, below, and the corners below right and
+        // below left (only crossed diagonally)
+        const int Sides = 4;
+
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        class Graph
+        {
+        public:
+            // Build the graph of entrances of grid for clusters of size x size tiles. The grid is kept by
+            // reference and must outlive the graph (see Set to change it).
+            Graph(AStar::Grid &grid, int size = 16) : Map(grid), Size(std::max(size, 1)), Local(Size, Size)
+            {
+                static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+                Columns = (Map.Width + Size - 1) / Size;
+
+                Rows = (Map.Height + Size - 1) / Size;
+
+                Transitions.resize(Columns * Rows * AStar::HPA::Sides);
+
+                Members.resize(Columns * Rows);
+
+                for (auto cluster = 0; cluster < Columns * Rows; cluster++)
+                {
+                    for (auto side = 0; side < AStar::HPA::Sides; side++)
+                    {
+                        Link(cluster, side);
+                    }
+                }
+
+                for (auto cluster = 0; cluster < Columns * Rows; cluster++)
+                {
+                    Place(cluster);
+                }
+
+                for (auto cluster = 0; cluster < Columns * Rows; cluster++)
+                {
+                    Connect(cluster);
+                }
+            }
+
+            // Number of clusters
+            int Clusters()
+            {
+                return Columns * Rows;
+            }
+
+            // Number of entrances
+            int Entrances()
+            {
+                return Ids.size();
+            }
+
+            // Change whether the tile at (x, y) can be traversed and its weight (see Grid::Set)
+            void Set(int x, int y, bool passable, int weight = 0)
+            {
+                Map.Set(x, y, passable, weight);
+
+                Update(x, y);
+            }
+
+            // Rebuild the graph around the tile at (x, y) after it has changed in the grid. Only its cluster
+            // and the entrances it shares with the clusters around it are rebuilt.
+            void Update(int x, int y)
+            {
+                if (!Map.Contains(x, y))
+                {
+                    return;
+                }
+
+                Loaded = -1;
+
+                // Every transition the tile is on or next to belongs to its cluster or one of the 8 around it
+                int around[9];
+
+                auto count = 0;
+
+                for (auto row = y / Size - 1; row <= y / Size + 1; row++)
+                {
+                    for (auto column = x / Size - 1; column <= x / Size + 1; column++)
+                    {
+                        if (column >= 0 && column < Columns && row >= 0 && row < Rows)
+                        {
+                            around[count++] = row * Columns + column;
+                        }
+                    }
+                }
+
+                for (auto i = 0; i < count; i++)
+                {
+                    for (auto side = 0; side < AStar::HPA::Sides; side++)
+                    {
+                        Link(around[i], side);
+                    }
+                }
+
+                for (auto i = 0; i < count; i++)
+                {
+                    Place(around[i]);
+                }
+
+                for (auto i = 0; i < count; i++)
+                {
+                    Connect(around[i]);
+                }
+            }
+
+            // Find path from tile src to tile dst (see Grid::Index). The graph of entrances is searched with
+            // the given context, which also keeps the path.
+            AStar::Path &FindPath(int src, int dst, AStar::SearchContext &context)
+            {
+                auto &path = context.Path;
+
+                path.Points.clear();
+
+                if (src < 0 || dst < 0 || !Map.IsPassable(src) || !Map.IsPassable(dst))
+                {
+                    return path;
+                }
+
+                if (src == dst)
+                {
+                    path.Points.push_back(AStar::Point(Map.X(src), Map.Y(src)));
+
+                    return path;
+                }
+
+                // Join src and dst to the entrances of their clusters (and to each other if they share one)
+                auto from = Attach(src, true);
+
+                auto to = Attach(dst, false);
+
+                if (Cluster(src) == Cluster(dst))
+                {
+                    Load(Cluster(src));
+
+                    AStar::Flood<Connectivity, Corners>(Local, Inside(src), Scratch);
+
+                    if (Reach(dst) >= 0)
+                    {
+                        Add(from, to, Reach(dst));
+                    }
+                }
+
+                Search(from, to, context);
+
+                // Forget src and dst
+                while (!Added.empty())
+                {
+                    Nodes[Added.back()].Edges.pop_back();
+
+                    Added.pop_back();
+                }
+
+                for (auto id : Temporary)
+                {
+                    Nodes[id].Tile = -1;
+
+                    Free.push_back(id);
+                }
+
+                Temporary.clear();
+
+                if (Route.empty())
+                {
+                    return path;
+                }
+
+                // Refine the path: steps between clusters are kept and paths inside clusters are searched again
+                path.Points.push_back(AStar::Point(Map.X(src), Map.Y(src)));
+
+                for (auto i = 0; i + 1 < (int)Route.size(); i++)
+                {
+                    auto a = Route[i];
+
+                    auto b = Route[i + 1];
+
+                    if (Cluster(a) != Cluster(b))
+                    {
+                        path.Points.push_back(AStar::Point(Map.X(b), Map.Y(b)));
+
+                        continue;
+                    }
+
+                    Load(Cluster(a));
+
+                    auto &segment = AStar::FindPath<Connectivity, Corners>(Local, Inside(a), Inside(b), Scratch).Points;
+
+                    for (auto j = 1; j < (int)segment.size(); j++)
+                    {
+                        path.Points.push_back(AStar::Point(segment[j].X + OriginX, segment[j].Y + OriginY));
+                    }
+                }
+
+                return path;
+            }
+
+            // Find path from src to dst
+            AStar::Path &FindPath(const char src, const char dst, AStar::SearchContext &context)
+            {
+                return FindPath(Map.Find(src), Map.Find(dst), context);
+            }
+
+        private:
+            struct Edge
+            {
+                int To;
+
+                int Cost;
+            };
+
+            // Entrance (or src or dst during a query) and the entrances that can be reached from it
+            struct Node
+            {
+                int Tile = -1;
+
+                std::vector<Edge> Edges;
+            };
+
+            AStar::Grid &Map;
+
+            // Cluster dimensions and number of clusters across and down the map
+            int Size;
+
+            int Columns;
+
+            int Rows;
+
+            // Pairs of tiles (in the cluster, across its border) where each of the Sides of a cluster can be
+            // crossed (at Sides * cluster + side)
+            std::vector<std::vector<std::pair<int, int>>> Transitions;
+
+            // Entrances of each cluster
+            std::vector<std::vector<int>> Members;
+
+            // Entrance on each tile
+            std::unordered_map<int, int> Ids;
+
+            std::vector<Node> Nodes;
+
+            // Nodes no longer in use
+            std::vector<int> Free;
+
+            // Nodes and edges added for a query
+            std::vector<int> Temporary;
+
+            std::vector<int> Added;
+
+            // Tiles of the nodes on the path found in the graph
+            std::vector<int> Route;
+
+            std::vector<int> Tiles;
+
+            // Copy of the last cluster searched (Loaded) and its position on the map
+            AStar::Grid Local;
+
+            AStar::SearchContext Scratch;
+
+            int Loaded = -1;
+
+            int OriginX = 0;
+
+            int OriginY = 0;
+
+            int Cluster(int tile)
+            {
+                return (Map.Y(tile) / Size) * Columns + Map.X(tile) / Size;
+            }
+
+            // Tile of the copy of the loaded cluster
+            int Inside(int tile)
+            {
+                return Local.Index(Map.X(tile) - OriginX, Map.Y(tile) - OriginY);
+            }
+
+            // Cost of stepping from tile to tile across a border
+            int Step(int from, int to)
+            {
+                auto step = Connectivity == 4 ? 1 : AStar::Straight;
+
+                if (Map.X(from) != Map.X(to) && Map.Y(from) != Map.Y(to))
+                {
+                    step = AStar::Diagonal;
+                }
+
+                return step * (Map.IsWeighted() ? Map.Weights[to] : 1);
+            }
+
+            // Cluster across a side of a cluster or, if back, the cluster whose side it is across (-1 if
+            // there is none)
+            int Neighbour(int cluster, int side, bool back = false)
+            {
+                auto dx = side == 1 ? 0 : (side == 3 ? -1 : 1);
+
+                auto dy = side == 0 ? 0 : 1;
+
+                auto column = cluster % Columns + (back ? -dx : dx);
+
+                auto row = cluster / Columns + (back ? -dy : dy);
+
+                if (column < 0 || column >= Columns || row < 0 || row >= Rows)
+                {
+                    return -1;
+                }
+
+                return row * Columns + column;
+            }
+
+            int New(int tile)
+            {
+                auto id = (int)Nodes.size();
+
+                if (!Free.empty())
+                {
+                    id = Free.back();
+
+                    Free.pop_back();
+                }
+                else
+                {
+                    Nodes.push_back(Node());
+                }
+
+                Nodes[id].Tile = tile;
+
+                Nodes[id].Edges.clear();
+
+                return id;
+            }
+
+            // Add an edge for the current query only
+            void Add(int from, int to, int cost)
+            {
+                Nodes[from].Edges.push_back({to, cost});
+
+                Added.push_back(from);
+            }
+
+            // Find where one of the Sides of a cluster can be crossed
+            void Link(int cluster, int side)
+            {
+                auto &pairs = Transitions[cluster * AStar::HPA::Sides + side];
+
+                pairs.clear();
+
+                if (Neighbour(cluster, side) < 0)
+                {
+                    return;
+                }
+
+                auto cut = Connectivity == 8 && Corners == AStar::Corners::Cut;
+
+                auto x = (cluster % Columns) * Size;
+
+                auto y = (cluster / Columns) * Size;
+
+                auto width = std::min(Size, Map.Width - x);
+
+                auto height = std::min(Size, Map.Height - y);
+
+                // Diagonal step from tile by (dx, dy) past two blocked tiles, which only Corners::Cut allows
+                auto squeeze = [&](int tile, int dx, int dy)
+                {
+                    auto next = tile + dx + dy * Map.Stride;
+
+                    if (Map.IsPassable(tile) && Map.IsPassable(next) && !Map.IsPassable(tile + dx) && !Map.IsPassable(tile + dy * Map.Stride))
+                    {
+                        pairs.push_back({tile, next});
+                    }
+                };
+
+                if (side >= 2)
+                {
+                    if (cut)
+                    {
+                        squeeze(side == 2 ? Map.Index(x + width - 1, y + height - 1) : Map.Index(x, y + height - 1), side == 2 ? 1 : -1, 1);
+                    }
+
+                    return;
+                }
+
+                auto length = side == 0 ? height : width;
+
+                // i-th tile along the border on this side and the tile across it
+                auto at = [&](int i)
+                {
+                    return side == 0 ? Map.Index(x + width - 1, y + i) : Map.Index(x + i, y + height - 1);
+                };
+
+                auto across = side == 0 ? 1 : Map.Stride;
+
+                auto run = 0;
+
+                for (auto i = 0; i <= length; i++)
+                {
+                    if (i < length && Map.IsPassable(at(i)) && Map.IsPassable(at(i) + across))
+                    {
+                        run++;
+
+                        continue;
+                    }
+
+                    if (run >= AStar::HPA::Wide)
+                    {
+                        pairs.push_back({at(i - run), at(i - run) + across});
+
+                        pairs.push_back({at(i - 1), at(i - 1) + across});
+                    }
+                    else if (run > 0)
+                    {
+                        auto middle = at(i - run + (run - 1) / 2);
+
+                        pairs.push_back({middle, middle + across});
+                    }
+
+                    run = 0;
+                }
+
+                // Diagonal steps across the border where its tiles cannot be crossed between straight
+                if (cut)
+                {
+                    for (auto i = 0; i < length; i++)
+                    {
+                        for (auto k = -1; k <= 1; k += 2)
+                        {
+                            if (i + k >= 0 && i + k < length)
+                            {
+                                squeeze(at(i), side == 0 ? 1 : k, side == 0 ? k : 1);
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Update the entrances of a cluster from the transitions on its borders
+            void Place(int cluster)
+            {
+                Tiles.clear();
+
+                for (auto side = 0; side < AStar::HPA::Sides; side++)
+                {
+                    for (auto &pair : Transitions[cluster * AStar::HPA::Sides + side])
+                    {
+                        Tiles.push_back(pair.first);
+                    }
+
+                    auto other = Neighbour(cluster, side, true);
+
+                    if (other >= 0)
+                    {
+                        for (auto &pair : Transitions[other * AStar::HPA::Sides + side])
+                        {
+                            Tiles.push_back(pair.second);
+                        }
+                    }
+                }
+
+                std::sort(Tiles.begin(), Tiles.end());
+
+                Tiles.erase(std::unique(Tiles.begin(), Tiles.end()), Tiles.end());
+
+                // Remove entrances that are gone
+                for (auto id : Members[cluster])
+                {
+                    if (!std::binary_search(Tiles.begin(), Tiles.end(), Nodes[id].Tile))
+                    {
+                        Ids.erase(Nodes[id].Tile);
+
+                        Nodes[id].Tile = -1;
+
+                        Nodes[id].Edges.clear();
+
+                        Free.push_back(id);
+                    }
+                }
+
+                Members[cluster].clear();
+
+                for (auto tile : Tiles)
+                {
+                    auto found = Ids.find(tile);
+
+                    auto id = found != Ids.end() ? found->second : New(tile);
+
+                    Ids[tile] = id;
+
+                    Members[cluster].push_back(id);
+                }
+            }
+
+            // Rebuild the edges leaving the entrances of a cluster
+            void Connect(int cluster)
+            {
+                auto &members = Members[cluster];
+
+                for (auto id : members)
+                {
+                    Nodes[id].Edges.clear();
+                }
+
+                // Steps across the borders
+                auto cross = [&](int from, int to)
+                {
+                    Nodes[Ids[from]].Edges.push_back({Ids[to], Step(from, to)});
+                };
+
+                for (auto side = 0; side < AStar::HPA::Sides; side++)
+                {
+                    for (auto &pair : Transitions[cluster * AStar::HPA::Sides + side])
+                    {
+                        cross(pair.first, pair.second);
+                    }
+
+                    auto other = Neighbour(cluster, side, true);
+
+                    if (other >= 0)
+                    {
+                        for (auto &pair : Transitions[other * AStar::HPA::Sides + side])
+                        {
+                            cross(pair.second, pair.first);
+                        }
+                    }
+                }
+
+                // Paths inside the cluster
+                Load(cluster);
+
+                for (auto from : members)
+                {
+                    AStar::Flood<Connectivity, Corners>(Local, Inside(Nodes[from].Tile), Scratch);
+
+                    for (auto to : members)
+                    {
+                        if (to != from && Reach(Nodes[to].Tile) >= 0)
+                        {
+                            Nodes[from].Edges.push_back({to, Reach(Nodes[to].Tile)});
+                        }
+                    }
+                }
+            }
+
+            // Copy a cluster into Local, so searches cannot leave it
+            void Load(int cluster)
+            {
+                if (Loaded == cluster)
+                {
+                    return;
+                }
+
+                Loaded = cluster;
+
+                OriginX = (cluster % Columns) * Size;
+
+                OriginY = (cluster / Columns) * Size;
+
+                std::fill(Local.Bits.begin(), Local.Bits.end(), 0);
+
+                std::fill(Local.Columns.begin(), Local.Columns.end(), 0);
+
+                Local.Weights.clear();
+
+                Local.MinimumWeight = Map.MinimumWeight;
+
+                if (Map.IsWeighted())
+                {
+                    Local.Weights.assign(Local.Size(), 0);
+                }
+
+                auto width = std::min(Size, Map.Width - OriginX);
+
+                auto height = std::min(Size, Map.Height - OriginY);
+
+                for (auto y = 0; y < height; y++)
+                {
+                    for (auto x = 0; x < width; x++)
+                    {
+                        auto tile = Map.Index(OriginX + x, OriginY + y);
+
+                        if (Map.IsPassable(tile))
+                        {
+                            Local.Set(x, y, true);
+
+                            if (Map.IsWeighted())
+                            {
+                                Local.Weights[Local.Index(x, y)] = Map.Weights[tile];
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Cost found by the last flood for tile (-1 if it cannot be reached)
+            int Reach(int tile)
+            {
+                auto id = Inside(tile);
+
+                return Scratch.Seen(id) ? Scratch.Costs[id] : -1;
+            }
+
+            // Node for tile src (Outgoing) or dst of a query, with its edges to the entrances of its cluster
+            int Attach(int tile, bool outgoing)
+            {
+                auto found = Ids.find(tile);
+
+                if (found != Ids.end())
+                {
+                    return found->second;
+                }
+
+                auto id = New(tile);
+
+                Temporary.push_back(id);
+
+                auto cluster = Cluster(tile);
+
+                Load(cluster);
+
+                if (outgoing)
+                {
+                    AStar::Flood<Connectivity, Corners>(Local, Inside(tile), Scratch);
+                }
+                else
+                {
+                    AStar::Flood<Connectivity, Corners, true>(Local, Inside(tile), Scratch);
+                }
+
+                for (auto member : Members[cluster])
+                {
+                    auto cost = Reach(Nodes[member].Tile);
+
+                    if (cost < 0)
+                    {
+                        continue;
+                    }
+
+                    if (outgoing)
+                    {
+                        Add(id, member, cost);
+                    }
+                    else
+                    {
+                        Add(member, id, cost);
+                    }
+                }
+
+                return id;
+            }
+
+            // A* search of the graph from node src to node dst, leaving the tiles on the path in Route
+            void Search(int src, int dst, AStar::SearchContext &context)
+            {
+                Route.clear();
+
+                auto X = Map.X(Nodes[dst].Tile);
+
+                auto Y = Map.Y(Nodes[dst].Tile);
+
+                auto minimum = Map.IsWeighted() ? Map.MinimumWeight : 1;
+
+                auto distance = [&](int id)
+                {
+                    return AStar::Distance<Connectivity>(Map.X(Nodes[id].Tile), Map.Y(Nodes[id].Tile), X, Y) * minimum;
+                };
+
+                context.Reset(Nodes.size());
+
+                auto &active = context.Open;
+
+                context.See(src);
+
+                context.Costs[src] = 0;
+
+                context.Parents[src] = AStar::None;
+
+                active.Push(src, distance(src));
+
+                while (!active.Empty())
+                {
+                    auto id = active.Pop();
+
+                    if (id == dst)
+                    {
+                        for (auto node = (std::uint32_t)id; node != AStar::None; node = context.Parents[node])
+                        {
+                            Route.push_back(Nodes[node].Tile);
+                        }
+
+                        std::reverse(Route.begin(), Route.end());
+
+                        return;
+                    }
+
+                    context.Close(id);
+
+                    for (auto &edge : Nodes[id].Edges)
+                    {
+                        auto next = edge.To;
+
+                        auto cost = context.Costs[id] + edge.Cost;
+
+                        if (!context.Seen(next))
+                        {
+                            context.See(next);
+
+                            context.Costs[next] = cost;
+
+                            context.Parents[next] = id;
+
+                            active.Push(next, cost + distance(next));
+                        }
+                        else if (!context.IsClosed(next) && cost < context.Costs[next])
+                        {
+                            context.Costs[next] = cost;
+
+                            context.Parents[next] = id;
+
+                            active.Decrease(next, cost + distance(next));
+                        }
+                    }
+                }
+            }
+        };
+    }
+}
+#endif
@@ -0,0 +1,440 @@
+#ifndef __JPS_HPP__
+#define __JPS_HPP__
+
+#include "astarv2.hpp"
+
+// Jump Point Search (Harabor and Grastien, 2011) for grids where every step has the same cost.
+//
+// Instead of adding every neighbor to the open list, JPS moves in straight lines ("jumps") and only
+// stops at tiles where the path may have to turn (jump points), so symmetric paths are never expanded.
+// The paths found are as short as the ones found by A*.
+//
+// 8-connected grids do not allow cutting corners (see Corners::Avoid) and use the same fixed-point
+// costs as A* (see Straight and Diagonal).
+//
+// Weights (see Grid::Weights) are ignored: use FindPath on grids with weighted terrain.
+namespace AStar
+{
+    namespace JPS
+    {
+        int Sign(int value)
+        {
+            return (value > 0) - (value < 0);
+        }
+
+        // Scan a line of tiles (a row of the bitmap or a column of the transposed bitmap) from position pos
+        // in direction dir (1 or -1), 64 tiles at a time. near and far are the lines on either side of it.
+        // Stops at target (-1 if not on this line) or at a tile with a forced neighbor on either side, i.e.
+        // a neighbor that is passable while the tile behind it is not, which is only reachable optimally
+        // through this tile.
+        //
+        // Returns the position of the tile found or -1 if an obstacle is reached first.
+        int Scan(const std::uint64_t *line, const std::uint64_t *near, const std::uint64_t *far, int words, int pos, int dir, int target)
+        {
+            pos += dir;
+
+            auto word = pos >> 6;
+
+            if (dir > 0)
+            {
+                // Tiles at or after pos
+                auto mask = ~std::uint64_t(0) << (pos & 63);
+
+                for (; word < words; word++, mask = ~std::uint64_t(0))
+                {
+                    // Shift the tiles behind (to the left of) each tile into its position
+                    auto carry = word > 0 ? 1 : 0;
+
+                    auto behindNear = (near[word] << 1) | (carry ? near[word - 1] >> 63 : 0);
+
+                    auto behindFar = (far[word] << 1) | (carry ? far[word - 1] >> 63 : 0);
+
+                    auto stops = ((near[word] & ~behindNear) | (far[word] & ~behindFar)) & mask;
+
+                    if (target >= 0 && (target >> 6) == word)
+                    {
+                        stops |= (std::uint64_t(1) << (target & 63)) & mask;
+                    }
+
+                    auto blocked = ~line[word] & mask;
+
+                    if (stops | blocked)
+                    {
+                        auto first = __builtin_ctzll(stops | blocked);
+
+                        return ((blocked >> first) & 1) ? -1 : word * 64 + first;
+                    }
+                }
+            }
+            else
+            {
+                // Tiles at or before pos
+                auto mask = ~std::uint64_t(0) >> (63 - (pos & 63));
+
+                for (; word >= 0; word--, mask = ~std::uint64_t(0))
+                {
+                    // Shift the tiles behind (to the right of) each tile into its position
+                    auto carry = word + 1 < words ? 1 : 0;
+
+                    auto behindNear = (near[word] >> 1) | (carry ? near[word + 1] << 63 : 0);
+
+                    auto behindFar = (far[word] >> 1) | (carry ? far[word + 1] << 63 : 0);
+
+                    auto stops = ((near[word] & ~behindNear) | (far[word] & ~behindFar)) & mask;
+
+                    if (target >= 0 && (target >> 6) == word)
+                    {
+                        stops |= (std::uint64_t(1) << (target & 63)) & mask;
+                    }
+
+                    auto blocked = ~line[word] & mask;
+
+                    if (stops | blocked)
+                    {
+                        auto last = 63 - __builtin_clzll(stops | blocked);
+
+                        return ((blocked >> last) & 1) ? -1 : word * 64 + last;
+                    }
+                }
+            }
+
+            // Never reached, lines always end with a blocked border tile
+            return -1;
+        }
+
+        // Jump in a straight line from tile id, moving by step (-1, 1, -Stride or Stride) in each iteration.
+        // Stops at dst or at a tile with a forced neighbor (see Scan).
+        //
+        // Returns the jump point found or -1 if an obstacle is reached first.
+        int Jump(AStar::Grid &grid, int id, int step, int dst)
+        {
+            auto x = grid.X(id);
+
+            auto y = grid.Y(id);
+
+            if (step == 1 || step == -1)
+            {
+                auto target = grid.Y(dst) == y ? grid.X(dst) + 1 : -1;
+
+                auto found = AStar::JPS::Scan(grid.Row(y), grid.Row(y - 1), grid.Row(y + 1), grid.Stride / 64, x + 1, step, target);
+
+                return found < 0 ? -1 : id + found - (x + 1);
+            }
+
+            auto target = grid.X(dst) == x ? grid.Y(dst) + 1 : -1;
+
+            auto found = AStar::JPS::Scan(grid.Column(x), grid.Column(x - 1), grid.Column(x + 1), grid.ColumnStride / 64, y + 1, step > 0 ? 1 : -1, target);
+
+            return found < 0 ? -1 : id + (found - (y + 1)) * grid.Stride;
+        }
+
+        // Sweep horizontally (4-connected) or diagonally (8-connected) from tile id. Paths are assumed to
+        // move horizontally (diagonally) first, so a tile is a jump point if a vertical (straight) jump
+        // from it finds one.
+        //
+        // Returns the jump point found or -1 if an obstacle is reached first.
+        template <int Connectivity>
+        int Sweep(AStar::Grid &grid, int id, int dx, int dy, int dst)
+        {
+            auto stride = grid.Stride;
+
+            auto step = dx + dy * stride;
+
+            while (true)
+            {
+                id += step;
+
+                if (!grid.IsPassable(id))
+                {
+                    return -1;
+                }
+
+                if (id == dst)
+                {
+                    return id;
+                }
+
+                if (Connectivity == 8)
+                {
+                    if (AStar::JPS::Jump(grid, id, dx, dst) >= 0 || AStar::JPS::Jump(grid, id, dy * stride, dst) >= 0)
+                    {
+                        return id;
+                    }
+
+                    // Do not cut corners
+                    if (!grid.IsPassable(id + dx) || !grid.IsPassable(id + dy * stride))
+                    {
+                        return -1;
+                    }
+                }
+                else if (AStar::JPS::Jump(grid, id, stride, dst) >= 0 || AStar::JPS::Jump(grid, id, -stride, dst) >= 0)
+                {
+                    return id;
+                }
+            }
+        }
+
+        // Get the directions (X, Y) worth jumping to from tile id, after arriving from direction (dx, dy)
+        // (0, 0 for src). Returns the number of directions.
+        template <int Connectivity>
+        int Directions(AStar::Grid &grid, int id, int dx, int dy, int directions[8][2])
+        {
+            auto stride = grid.Stride;
+
+            auto count = 0;
+
+            auto add = [&](int x, int y)
+            {
+                directions[count][0] = x;
+
+                directions[count][1] = y;
+
+                count++;
+            };
+
+            auto open = [&](int x, int y)
+            {
+                return grid.IsPassable(id + x + y * stride);
+            };
+
+            if (dx == 0 && dy == 0)
+            {
+                // Start: Up, Down, Left, Right (and diagonals if they do not cut corners)
+                for (auto y = -1; y <= 1; y++)
+                {
+                    for (auto x = -1; x <= 1; x++)
+                    {
+                        if ((x == 0) != (y == 0) || (Connectivity == 8 && x != 0 && y != 0 && open(x, 0) && open(0, y)))
+                        {
+                            add(x, y);
+                        }
+                    }
+                }
+            }
+            else if (Connectivity == 4)
+            {
+                if (dx != 0)
+                {
+                    // Moving horizontally: keep going and try both vertical directions
+                    add(dx, 0);
+
+                    add(0, -1);
+
+                    add(0, 1);
+                }
+                else
+                {
+                    // Moving vertically: keep going and only turn towards forced neighbors
+                    add(0, dy);
+
+                    for (auto x = -1; x <= 1; x += 2)
+                    {
+                        if (open(x, 0) && !open(x, -dy))
+                        {
+                            add(x, 0);
+                        }
+                    }
+                }
+            }
+            else if (dx != 0 && dy != 0)
+            {
+                // Moving diagonally: keep going and try both straight components
+                add(dx, 0);
+
+                add(0, dy);
+
+                if (open(dx, 0) && open(0, dy))
+                {
+                    add(dx, dy);
+                }
+            }
+            else
+            {
+                // Moving in a straight line: keep going, turn to either side and move diagonally forward
+                for (auto side = -1; side <= 1; side += 2)
+                {
+                    auto sx = dy != 0 ? side : 0;
+
+                    auto sy = dx != 0 ? side : 0;
+
+                    if (open(sx, sy))
+                    {
+                        add(sx, sy);
+
+                        if (open(dx, dy))
+                        {
+                            add(dx + sx, dy + sy);
+                        }
+                    }
+                }
+
+                add(dx, dy);
+            }
+
+            return count;
+        }
+
+        // Find path from tile src to tile dst (see Grid::Index) using Jump Point Search
+        //
+        // The path is kept in the given context and remains valid until its next search
+        template <int Connectivity = 4>
+        AStar::Path &FindPath(AStar::Grid &grid, int src, int dst, AStar::SearchContext &context)
+        {
+            static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+            auto &path = context.Path;
+
+            path.Points.clear();
+
+            if (src < 0 || dst < 0)
+            {
+                return path;
+            }
+
+            auto X = grid.X(dst);
+
+            auto Y = grid.Y(dst);
+
+            context.Reset(grid.Size());
+
+            // List of jump points to be checked (open list) keyed on CostDistance
+            auto &active = context.Open;
+
+            context.See(src);
+
+            context.Costs[src] = 0;
+
+            context.Parents[src] = AStar::None;
+
+            active.Push(src, AStar::Distance<Connectivity>(grid.X(src), grid.Y(src), X, Y));
+
+            int directions[8][2];
+
+            while (!active.Empty())
+            {
+                auto id = active.Pop();
+
+                if (id == dst)
+                {
+                    // Fill in the tiles between jump points, walking back from dst
+                    for (auto node = (std::uint32_t)id; node != AStar::None;)
+                    {
+                        auto parent = context.Parents[node];
+
+                        if (parent == AStar::None)
+                        {
+                            path.Points.push_back(AStar::Point(grid.X(node), grid.Y(node)));
+
+                            break;
+                        }
+
+                        auto step = AStar::JPS::Sign(grid.X(parent) - grid.X(node)) + AStar::JPS::Sign(grid.Y(parent) - grid.Y(node)) * grid.Stride;
+
+                        for (auto tile = node; tile != parent; tile += step)
+                        {
+                            path.Points.push_back(AStar::Point(grid.X(tile), grid.Y(tile)));
+                        }
+
+                        node = parent;
+                    }
+
+                    // Reverse list of coordinates so path leads from src to dst
+                    std::reverse(path.Points.begin(), path.Points.end());
+
+                    return path;
+                }
+
+                context.Close(id);
+
+                auto x = grid.X(id);
+
+                auto y = grid.Y(id);
+
+                auto dx = 0;
+
+                auto dy = 0;
+
+                if (context.Parents[id] != AStar::None)
+                {
+                    dx = AStar::JPS::Sign(x - grid.X(context.Parents[id]));
+
+                    dy = AStar::JPS::Sign(y - grid.Y(context.Parents[id]));
+                }
+
+                auto count = AStar::JPS::Directions<Connectivity>(grid, id, dx, dy, directions);
+
+                for (auto i = 0; i < count; i++)
+                {
+                    auto &direction = directions[i];
+
+                    int next;
+
+                    if (Connectivity == 4 && direction[1] != 0)
+                    {
+                        next = AStar::JPS::Jump(grid, id, direction[1] * grid.Stride, dst);
+                    }
+                    else if (Connectivity == 8 && (direction[0] == 0 || direction[1] == 0))
+                    {
+                        next = AStar::JPS::Jump(grid, id, direction[0] + direction[1] * grid.Stride, dst);
+                    }
+                    else
+                    {
+                        next = AStar::JPS::Sweep<Connectivity>(grid, id, direction[0], direction[1], dst);
+                    }
+
+                    if (next < 0)
+                    {
+                        continue;
+                    }
+
+                    auto nx = grid.X(next);
+
+                    auto ny = grid.Y(next);
+
+                    auto cost = context.Costs[id] + AStar::Distance<Connectivity>(x, y, nx, ny);
+
+                    auto distance = cost + AStar::Distance<Connectivity>(nx, ny, X, Y);
+
+                    if (!context.Seen(next))
+                    {
+                        context.See(next);
+
+                        context.Costs[next] = cost;
+
+                        context.Parents[next] = id;
+
+                        active.Push(next, distance);
+                    }
+                    else if (!context.IsClosed(next) && cost < context.Costs[next])
+                    {
+                        context.Costs[next] = cost;
+
+                        context.Parents[next] = id;
+
+                        active.Decrease(next, distance);
+                    }
+                }
+            }
+
+            return path;
+        }
+
+        // Find path from src to dst using Jump Point Search
+        template <int Connectivity = 4>
+        AStar::Path &FindPath(AStar::Grid &grid, const char src, const char dst, AStar::SearchContext &context)
+        {
+            return AStar::JPS::FindPath<Connectivity>(grid, grid.Find(src), grid.Find(dst), context);
+        }
+
+        template <int Connectivity = 4>
+        AStar::Path FindPath(std::vector<std::string> &map, const char src, const char dst, const char passable)
+        {
+            auto grid = AStar::Grid(map, passable, std::string({src, dst}));
+
+            auto context = AStar::SearchContext();
+
+            return AStar::JPS::FindPath<Connectivity>(grid, src, dst, context);
+        }
+    }
+}
+#endif
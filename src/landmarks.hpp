@@ -0,0 +1,376 @@
+#ifndef __LANDMARKS_HPP__
+#define __LANDMARKS_HPP__
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "batch.hpp"
+
+// Landmark heuristic (ALT: A*, landmarks and the triangle inequality).
+//
+// The cost of reaching every tile from a few landmark tiles is found ahead of time. Going from a tile to
+// dst cannot cost less than the difference between their costs from any landmark (or the path through
+// the tile would beat the cheapest path from the landmark), which on mazes estimates the remaining cost
+// far better than the distance between the tiles, so A* expands far fewer tiles.
+namespace AStar
+{
+    // Costs from the landmarks, stored as T (costs above its largest value but one are capped)
+    template <typename T = std::uint16_t>
+    class Landmarks
+    {
+    public:
+        // Cost of a tile that cannot be reached from a landmark
+        static constexpr T Unreachable = std::numeric_limits<T>::max();
+
+        // Tile of each landmark (see Grid::Index)
+        std::vector<int> Tiles;
+
+        Landmarks()
+        {
+        }
+
+        ~Landmarks()
+        {
+            Unmap();
+        }
+
+        Landmarks(const Landmarks &) = delete;
+
+        Landmarks &operator=(const Landmarks &) = delete;
+
+        // Find the costs from the given landmark tiles, one landmark per thread (see Batch)
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        void Build(AStar::Grid &grid, const std::vector<int> &tiles, int threads = std::thread::hardware_concurrency())
+        {
+            Unmap();
+
+            Tiles = tiles;
+
+            Size = grid.Size();
+
+            Symmetric = !grid.IsWeighted();
+
+            Costs.assign((std::size_t)Size * Tiles.size(), Unreachable);
+
+            Table = Costs.data();
+
+            auto count = (int)Tiles.size();
+
+            auto batch = AStar::Batch(std::min(threads, count));
+
+            batch.Run(count, [&](int i, AStar::SearchContext &context)
+                      {
+                          AStar::Flood<Connectivity, Corners>(grid, Tiles[i], context);
+
+                          for (auto id = 0; id < Size; id++)
+                          {
+                              if (context.Seen(id))
+                              {
+                                  Costs[(std::size_t)id * count + i] = std::min(context.Costs[id], (int)Unreachable - 1);
+                              }
+                          } });
+        }
+
+        // Find the costs from count landmarks spread around the edge of the map
+        template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+        void Build(AStar::Grid &grid, int count = 8, int threads = std::thread::hardware_concurrency())
+        {
+            Build<Connectivity, Corners>(grid, Place(grid, count), threads);
+        }
+
+        // Pick count tiles (at most) spread evenly around the edge of the map: the tiles that can be
+        // traversed nearest to count points along its edge
+        static std::vector<int> Place(AStar::Grid &grid, int count)
+        {
+            auto tiles = std::vector<int>();
+
+            auto width = grid.Width - 1;
+
+            auto height = grid.Height - 1;
+
+            auto perimeter = 2 * (width + height);
+
+            for (auto i = 0; i < count; i++)
+            {
+                // Walk clockwise from the top left corner
+                auto along = (int)((long long)perimeter * i / count);
+
+                auto x = std::min(along, width);
+
+                auto y = std::min(std::max(along - width, 0), height);
+
+                if (along > width + height)
+                {
+                    x = std::max(width - (along - width - height), 0);
+                }
+
+                if (along > 2 * width + height)
+                {
+                    y = std::max(height - (along - 2 * width - height), 0);
+                }
+
+                auto tile = Nearest(grid, x, y);
+
+                if (tile >= 0 && std::find(tiles.begin(), tiles.end(), tile) == tiles.end())
+                {
+                    tiles.push_back(tile);
+                }
+            }
+
+            return tiles;
+        }
+
+        // Number of landmarks
+        int Count()
+        {
+            return Tiles.size();
+        }
+
+        // Cost of reaching tile id from landmark i (Unreachable if it cannot be reached)
+        T Cost(int id, int i)
+        {
+            return Table[(std::size_t)id * Tiles.size() + i];
+        }
+
+        // Write the costs to a file that Load can map back into memory
+        bool Save(const std::string &filename)
+        {
+            auto file = std::fopen(filename.c_str(), "wb");
+
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            auto header = Header();
+
+            std::memcpy(header.Magic, "ALT1", 4);
+
+            header.Size = Size;
+
+            header.Width = sizeof(T);
+
+            header.Count = Tiles.size();
+
+            header.Symmetric = Symmetric;
+
+            auto ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+            ok = ok && std::fwrite(Tiles.data(), sizeof(int), Tiles.size(), file) == Tiles.size();
+
+            ok = ok && std::fwrite(Table, sizeof(T), (std::size_t)Size * Tiles.size(), file) == (std::size_t)Size * Tiles.size();
+
+            return std::fclose(file) == 0 && ok;
+        }
+
+        // Map costs saved for grid by Save into memory. Nothing is read until it is used and the memory is
+        // shared with other processes that map the same file.
+        bool Load(const std::string &filename, AStar::Grid &grid)
+        {
+            Unmap();
+
+            Tiles.clear();
+
+            Costs.clear();
+
+            Table = nullptr;
+
+            auto file = open(filename.c_str(), O_RDONLY);
+
+            if (file < 0)
+            {
+                return false;
+            }
+
+            struct stat status;
+
+            auto length = fstat(file, &status) == 0 ? (std::size_t)status.st_size : 0;
+
+            auto data = length >= sizeof(Header) ? mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+
+            close(file);
+
+            if (data == MAP_FAILED)
+            {
+                return false;
+            }
+
+            Mapped = data;
+
+            Length = length;
+
+            auto &header = *(const Header *)data;
+
+            auto offset = sizeof(Header) + (std::size_t)header.Count * sizeof(int);
+
+            if (std::memcmp(header.Magic, "ALT1", 4) != 0 || header.Width != sizeof(T) || (int)header.Size != grid.Size() || length != offset + (std::size_t)header.Size * header.Count * sizeof(T))
+            {
+                Unmap();
+
+                return false;
+            }
+
+            auto tiles = (const int *)((const char *)data + sizeof(Header));
+
+            Tiles.assign(tiles, tiles + header.Count);
+
+            Size = header.Size;
+
+            Symmetric = header.Symmetric;
+
+            Table = (const T *)((const char *)data + offset);
+
+            return true;
+        }
+
+        // Estimate of the cost of reaching dst (see FindPath)
+        template <int Connectivity = 4>
+        class Estimate
+        {
+        public:
+            Estimate(AStar::Grid &grid, int dst, AStar::Landmarks<T> &landmarks) : Base(grid, dst)
+            {
+                Count = landmarks.Tiles.size();
+
+                Table = landmarks.Table;
+
+                Goal = Table + (std::size_t)dst * Count;
+
+                Symmetric = landmarks.Symmetric;
+            }
+
+            // The largest of the Distance to dst and the differences between the costs of tile id and dst
+            // from each landmark. Costs from a landmark only bound the cost to dst from below if they are the
+            // same both ways (Symmetric), otherwise only landmarks closer to the tile than to dst tell anything.
+            int operator()(int id, int x, int y)
+            {
+                auto best = Base(id, x, y);
+
+                auto costs = Table + (std::size_t)id * Count;
+
+                for (auto i = 0; i < Count; i++)
+                {
+                    if (costs[i] == Unreachable || Goal[i] == Unreachable)
+                    {
+                        continue;
+                    }
+
+                    auto difference = (int)Goal[i] - (int)costs[i];
+
+                    best = std::max(best, Symmetric ? std::abs(difference) : difference);
+                }
+
+                return best;
+            }
+
+        private:
+            AStar::Heuristic<Connectivity> Base;
+
+            int Count;
+
+            const T *Table;
+
+            // Costs of dst from the landmarks
+            const T *Goal;
+
+            bool Symmetric;
+        };
+
+    private:
+        // Tile that can be traversed nearest to (x, y), looking in growing squares around it (-1 if none)
+        static int Nearest(AStar::Grid &grid, int x, int y)
+        {
+            for (auto r = 0; r <= std::max(grid.Width, grid.Height); r++)
+            {
+                for (auto j = y - r; j <= y + r; j++)
+                {
+                    // Only the edge of the square (the inside was searched with smaller squares)
+                    auto step = (j == y - r || j == y + r) ? 1 : 2 * r;
+
+                    for (auto i = x - r; i <= x + r; i += std::max(step, 1))
+                    {
+                        if (grid.Contains(i, j) && grid.IsPassable(grid.Index(i, j)))
+                        {
+                            return grid.Index(i, j);
+                        }
+                    }
+                }
+            }
+
+            return -1;
+        }
+
+        // Layout of the files written by Save: the header, Tiles, then the table
+        struct Header
+        {
+            char Magic[4];
+
+            // Bytes per cost
+            std::uint32_t Width;
+
+            std::uint32_t Size;
+
+            std::uint32_t Count;
+
+            std::uint32_t Symmetric;
+        };
+
+        // Number of tiles of the grid (see Grid::Size)
+        int Size = 0;
+
+        // Costs are the same both ways, i.e. the grid is not weighted
+        bool Symmetric = true;
+
+        // Costs from every landmark for one tile after another: Costs or the mapped file
+        std::vector<T> Costs;
+
+        const T *Table = nullptr;
+
+        void *Mapped = nullptr;
+
+        std::size_t Length = 0;
+
+        void Unmap()
+        {
+            if (Mapped != nullptr)
+            {
+                munmap(Mapped, Length);
+
+                Mapped = nullptr;
+            }
+        }
+    };
+
+    // Find path from tile src to tile dst with landmarks built for the same grid, Connectivity and Corners,
+    // with what the search does recorded in stats (see AStar::Stats)
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, typename T, typename S>
+    AStar::Path &FindPath(AStar::Grid &grid, int src, int dst, AStar::SearchContext &context, AStar::Landmarks<T> &landmarks, S &stats)
+    {
+        if (src < 0 || dst < 0 || landmarks.Count() == 0)
+        {
+            auto heuristic = AStar::Heuristic<Connectivity>(grid, std::max(dst, 0));
+
+            return AStar::FindPath<Connectivity, Corners>(grid, src, dst, context, heuristic, stats);
+        }
+
+        auto heuristic = typename AStar::Landmarks<T>::template Estimate<Connectivity>(grid, dst, landmarks);
+
+        return AStar::FindPath<Connectivity, Corners>(grid, src, dst, context, heuristic, stats);
+    }
+
+    // Find path from tile src to tile dst with landmarks built for the same grid, Connectivity and Corners
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, typename T>
+    AStar::Path &FindPath(AStar::Grid &grid, int src, int dst, AStar::SearchContext &context, AStar::Landmarks<T> &landmarks)
+    {
+        auto stats = AStar::NoStats();
+
+        return AStar::FindPath<Connectivity, Corners>(grid, src, dst, context, landmarks, stats);
+    }
+}
+#endif
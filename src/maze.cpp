@@ -1,200 +1,422 @@
-// From: https://github.com/Borroot/maze-generator with minor modification
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
-#include <assert.h>
+#include <string>
+#include <thread>
 #include <vector>
 
-using namespace std;
+#include "astarv2.hpp"
+#include "maze.hpp"
+
+// Maze generator, originally from https://github.com/Borroot/maze-generator
+//
+// A maze of width by height cells is drawn as a map of 2 * width + 1 by 2 * height + 1 tiles: every cell
+// is a room at odd coordinates, walled off from its neighbors ('-' on even rows, '|' on odd rows) except
+// where the two are joined. Every cell can be reached from every other by exactly one route. A is in the
+// bottom wall under the first cell of the last row and B in the right wall beside the last cell of the
+// first row, unless --start and --finish put them in the room of a given cell ("x,y", counted from 0)
+// or of a random one ("random").
+//
+// Usage: maze.exe [height] [width] [--algorithm backtrack|eller|kruskal] [--seed n] [--start x,y|random]
+//                 [--finish x,y|random] [--count n] [--threads n] [--output file]
+//
+// The same seed always makes the same maze, on any platform and with any compiler or number of threads
+// (the seed is printed to the console if it is not given). With --count, a corpus of n mazes is made
+// with seeds seed, seed + 1, ... and written to the output with the number of each maze before its
+// extension (maze.txt becomes maze-0.txt, maze-1.txt, ...), so any one of them can be made again on its
+// own with its seed.
+//
+// The maze is written as text (see examples/) to the output, or to the console if there is none, or as
+// a binary map (see Grid::Save) if the output ends with .grid. The algorithms are:
+//
+//   backtrack  depth-first search (the default): long winding corridors with few branches
+//   eller      Eller's algorithm: the maze is made a row at a time and each row is written as soon as it
+//              is done, so only one row is ever kept in memory
+//   kruskal    Kruskal's algorithm on strips of rows, made at the same time on their own threads and then
+//              joined to each other along their edges: many short dead ends
+//
+// Each cell takes a byte while the maze is made by backtrack, and five by kruskal, so mazes of millions of
+// cells take seconds. The algorithms themselves are in maze.hpp, which the benchmark shares.
+
+struct Options
+{
+    int Width = 15;
+
+    int Height = 15;
+
+    std::string Algorithm = "backtrack";
+
+    int Threads = std::max((int)std::thread::hardware_concurrency(), 1);
+
+    std::string Output;
+
+    // Seed of the first maze (the current time if not given)
+    std::uint64_t Seed = 0;
+
+    bool Seeded = false;
+
+    // Cells of A and B: "x,y", "random" or empty for the walls in the corners
+    std::string Start;
+
+    std::string Finish;
+
+    // Number of mazes to make
+    int Count = 1;
+};
 
-#define S 4 // path
-#define P 3 // path
-#define O 2 // obstacle
-#define V 1 // visited
-#define U 0 // unvisited
+// Writes each row of cells (see Flags) as the two rows of text they are drawn as
+class Text
+{
+public:
+    Text(std::FILE *file, int width, AStar::Point src, AStar::Point dst) : File(file), Width(width), Src(src), Dst(dst), Line(width * 2 + 2, '-')
+    {
+        Line.back() = '\n';
 
+        Write(0);
+    }
 
-struct Cell {
-	int x;
-	int y;
-};
+    bool Row(int y, const std::uint8_t *cells)
+    {
+        Line[0] = '|';
 
-const vector<Cell> DIRS = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+        for (auto x = 0; x < Width; x++)
+        {
+            Line[x * 2 + 1] = ' ';
 
-bool operator == (Cell c1, Cell c2){
-	return c1.x == c2.x && c1.y == c2.y;
-}
+            Line[x * 2 + 2] = cells[x] & Maze::East ? ' ' : '|';
+        }
 
-bool operator != (Cell c1, Cell c2){
-	return !(c1 == c2);
-}
+        Write(y * 2 + 1);
 
-ostream &operator << (ostream &out, Cell cell){
-	cout << "[" << cell.x << "," << cell.y << "]";
-	return out;
-}
+        Line[0] = '-';
 
-void print(vector<Cell> v){
-	cout << "{";
-	for(int i = 0; i < v.size(); i++){
-		cout << v[i];
+        for (auto x = 0; x < Width; x++)
+        {
+            Line[x * 2 + 1] = cells[x] & Maze::South ? ' ' : '-';
 
-		if(i != v.size()-1)
-			cout << ", ";
-	}
-	cout << "}" << endl;
-}
+            Line[x * 2 + 2] = '-';
+        }
 
-void print(vector<vector<int>> &maze){
-	for(int y = 0; y < maze.size(); y++){
-		for(int x = 0; x < maze[y].size(); x++){
-			if(maze[y][x] == O) {
-				if(y % 2 == 0)
-					cout << '-';
-				else
-					cout << '|';
-			} else if(maze[y][x] == V) {
-				cout << ' ';
-			} else if(maze[y][x] == U) {
-				cout << '.';
-			}else if(maze[y][x] == P) {
-				cout << 'B';
-			}else if(maze[y][x] == S) {
-				cout << 'A';
-			}
-			cout << " ";
-		}
-		cout << endl;
-	}
-}
+        return Write(y * 2 + 2);
+    }
 
-void init(vector<vector<int>> &maze, vector<Cell> &unvisited){
-	for(int y = 0; y < maze.size(); y++){
-		for(int x = 0; x < maze[y].size(); x++){
-			if(y % 2 == 0 || x % 2 == 0){
-				maze[y][x] = O;
-			}else{
-				maze[y][x] = U;
-				Cell cell = {x, y};
-				unvisited.push_back(cell);
-			}
-		}
-	}
-}
+    bool Close()
+    {
+        return std::fflush(File) == 0;
+    }
 
-int cell_value(vector<vector<int>> &maze, Cell cell){
-	return maze[cell.y][cell.x];
-}
+private:
+    std::FILE *File;
 
-bool valid_cell(vector<vector<int>> &maze, Cell cell){
-	return cell.x >= 0 && cell.y >= 0 && cell.x < maze[cell.y].size() && cell.y < maze.size();
-}
+    int Width;
 
-vector<Cell> neighbors(vector<vector<int>> &maze, Cell cell){
-	vector<Cell> neighbors;
+    // Tiles of A and B
+    AStar::Point Src;
 
-	for(int i = 0; i < DIRS.size(); i++){
-		int new_x = cell.x + DIRS[i].x*2;
-		int new_y = cell.y + DIRS[i].y*2;
-		Cell neighbor = {new_x, new_y};
+    AStar::Point Dst;
 
-		if(valid_cell(maze, neighbor)){
-			neighbors.push_back(neighbor);
-		}
-	}
-	return neighbors;
-}
+    std::string Line;
 
-bool unvisited_neighbors(vector<vector<int>> &maze, Cell cell){
-	vector<Cell> _neighbors = neighbors(maze, cell);
+    // Write Line as row y of tiles, with A and B if they are on it
+    bool Write(int y)
+    {
+        if (Src.Y == y)
+        {
+            Line[Src.X] = 'A';
+        }
 
-	for(int i = 0; i < _neighbors.size(); i++){
-		if(cell_value(maze, _neighbors[i]) == U){
-			return true;
-		}
-	}
-	return false;
-}
+        if (Dst.Y == y)
+        {
+            Line[Dst.X] = 'B';
+        }
 
-Cell random_unvisited_neighbor(vector<vector<int>> &maze, Cell cell){
-	assert(unvisited_neighbors(maze, cell));
+        return std::fwrite(Line.data(), 1, Line.size(), File) == Line.size();
+    }
+};
 
-	vector<Cell> _neighbors = neighbors(maze, cell);
-	vector<Cell> _unvisited_neighbors;
+// Sets the tiles of each row of cells (see Flags) in a grid, which is saved once the maze is done
+class Binary
+{
+public:
+    Binary(const std::string &filename, int width, int height, AStar::Point src, AStar::Point dst) : Filename(filename), Grid(width * 2 + 1, height * 2 + 1), Width(width), Src(src), Dst(dst)
+    {
+    }
 
-	for(int i = 0; i < _neighbors.size(); i++){
-		if(cell_value(maze, _neighbors[i]) == U){
-			_unvisited_neighbors.push_back(_neighbors[i]);
-		}
-	}
+    bool Row(int y, const std::uint8_t *cells)
+    {
+        for (auto x = 0; x < Width; x++)
+        {
+            Grid.Set(x * 2 + 1, y * 2 + 1, true);
 
-	int index = rand() % _unvisited_neighbors.size();
-	return _unvisited_neighbors[index];
-}
+            if (cells[x] & Maze::East)
+            {
+                Grid.Set(x * 2 + 2, y * 2 + 1, true);
+            }
+
+            if (cells[x] & Maze::South)
+            {
+                Grid.Set(x * 2 + 1, y * 2 + 2, true);
+            }
+        }
 
-void remove_wall(vector<vector<int>> &maze, Cell c1, Cell c2){
-	Cell wall = {(c1.x+c2.x)/2, (c1.y+c2.y)/2};
-	maze[wall.y][wall.x] = V;
+        return true;
+    }
+
+    bool Close()
+    {
+        Mark('A', Src);
+
+        Mark('B', Dst);
+
+        return Grid.Save(Filename);
+    }
+
+private:
+    std::string Filename;
+
+    AStar::Grid Grid;
+
+    int Width;
+
+    AStar::Point Src;
+
+    AStar::Point Dst;
+
+    void Mark(const char symbol, AStar::Point tile)
+    {
+        Grid.Set(tile.X, tile.Y, true);
+
+        Grid.Locate(symbol).push_back(Grid.Index(tile.X, tile.Y));
+    }
+};
+
+template <typename W>
+bool Generate(Options &options, std::uint64_t seed, W &writer)
+{
+    auto random = Maze::Random(seed);
+
+    auto ok = false;
+
+    if (options.Algorithm == "eller")
+    {
+        ok = Maze::Eller(options.Width, options.Height, random, writer);
+    }
+    else if (options.Algorithm == "kruskal")
+    {
+        ok = Maze::Kruskal(options.Width, options.Height, options.Threads, random, writer);
+    }
+    else
+    {
+        ok = Maze::Backtrack(options.Width, options.Height, random, writer);
+    }
+
+    return writer.Close() && ok;
 }
 
-void remove(vector<Cell> &v, Cell c){
-	for(int i = 0; i < v.size(); i++){
-		if(v[i] == c){
-			v.erase(v.begin() + i);
-		}
-	}
+// Tile of A or B: in the room of the cell given by where ("x,y" or "random"), or the given tile if where
+// is empty. Returns false if where is not a cell of the maze.
+bool Place(Options &options, const std::string &where, Maze::Random &random, AStar::Point &tile)
+{
+    auto x = 0;
+
+    auto y = 0;
+
+    if (where == "random")
+    {
+        x = random.Below(options.Width);
+
+        y = random.Below(options.Height);
+    }
+    else if (!where.empty())
+    {
+        char rest;
+
+        if (std::sscanf(where.c_str(), "%d,%d%c", &x, &y, &rest) != 2 || x < 0 || y < 0 || x >= options.Width || y >= options.Height)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return true;
+    }
+
+    tile = AStar::Point(x * 2 + 1, y * 2 + 1);
+
+    return true;
 }
 
-void generate(vector<vector<int>> &maze, vector<Cell> &unvisited, vector<Cell> &visited){
-	Cell current = unvisited.back();
-	unvisited.pop_back();
-	visited.push_back(current);
-	maze[current.y][current.x] = V;
-
-	while(unvisited.size() != 0){
-		if(unvisited_neighbors(maze, current)){
-			Cell neighbor = random_unvisited_neighbor(maze, current);
-			remove_wall(maze, current, neighbor);
-
-			current = neighbor;
-			remove(unvisited, current);
-			visited.push_back(current);
-			maze[current.y][current.x] = V;
-		}else if(visited.size() != 0){
-			current = visited.back();
-			visited.pop_back();
-		}
-	}
+// Name of maze i of a corpus: its number before the extension of output
+std::string Name(const std::string &output, int i)
+{
+    auto dot = output.rfind('.');
+
+    auto slash = output.rfind('/');
+
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        dot = output.size();
+    }
+
+    return output.substr(0, dot) + "-" + std::to_string(i) + output.substr(dot);
 }
 
-int main(int argc, char* argv[]){
-	srand(time(0));
+int main(int argc, char **argv)
+{
+    auto options = Options();
+
+    auto positional = 0;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        auto arg = std::string(argv[i]);
+
+        if (arg == "--algorithm" && i + 1 < argc)
+        {
+            options.Algorithm = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.Threads = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            options.Output = argv[++i];
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            options.Seed = std::strtoull(argv[++i], nullptr, 10);
+
+            options.Seeded = true;
+        }
+        else if (arg == "--start" && i + 1 < argc)
+        {
+            options.Start = argv[++i];
+        }
+        else if (arg == "--finish" && i + 1 < argc)
+        {
+            options.Finish = argv[++i];
+        }
+        else if (arg == "--count" && i + 1 < argc)
+        {
+            options.Count = std::atoi(argv[++i]);
+        }
+        else if (positional == 0)
+        {
+            // Height on its own makes a square maze
+            options.Height = std::atoi(argv[i]);
+
+            options.Width = options.Height;
+
+            positional++;
+        }
+        else
+        {
+            options.Width = std::atoi(argv[i]);
+        }
+    }
+
+    if (options.Algorithm != "backtrack" && options.Algorithm != "eller" && options.Algorithm != "kruskal")
+    {
+        std::cerr << "Unknown algorithm " << options.Algorithm << " (expected backtrack, eller or kruskal)" << std::endl;
+
+        return 1;
+    }
+
+    // Tiles are indexed by int in a grid
+    if (options.Width < 1 || options.Height < 1 || options.Count < 1 || ((double)options.Width * 2 + 67) * ((double)options.Height * 2 + 3) > INT32_MAX)
+    {
+        std::cerr << "Usage: " << argv[0] << " [height] [width] [--algorithm backtrack|eller|kruskal] [--seed n] [--start x,y|random] [--finish x,y|random] [--count n] [--threads n] [--output file]" << std::endl;
+
+        return 1;
+    }
+
+    if (options.Count > 1 && options.Output.empty())
+    {
+        std::cerr << "A corpus (--count) needs an --output to name its mazes after" << std::endl;
+
+        return 1;
+    }
+
+    if (!options.Seeded)
+    {
+        options.Seed = std::time(nullptr);
+
+        std::cerr << "Seed: " << options.Seed << std::endl;
+    }
+
+    for (auto i = 0; i < options.Count; i++)
+    {
+        auto seed = options.Seed + i;
+
+        // Random cells for A and B come from numbers of their own, so they do not change the maze
+        auto random = Maze::Random(~seed);
+
+        auto src = AStar::Point(1, options.Height * 2);
+
+        auto dst = AStar::Point(options.Width * 2, 1);
+
+        if (!Place(options, options.Start, random, src) || !Place(options, options.Finish, random, dst))
+        {
+            std::cerr << "Start and finish must be cells of the maze (x,y counted from 0) or random" << std::endl;
+
+            return 1;
+        }
+
+        // Two random cells may be the same one
+        for (auto tries = 0; src.X == dst.X && src.Y == dst.Y && options.Finish == "random" && tries < 100; tries++)
+        {
+            Place(options, options.Finish, random, dst);
+        }
+
+        if (src.X == dst.X && src.Y == dst.Y)
+        {
+            std::cerr << "Start and finish must be different cells" << std::endl;
+
+            return 1;
+        }
+
+        auto ok = false;
+
+        auto output = options.Count > 1 ? Name(options.Output, i) : options.Output;
+
+        if (output.size() > 5 && output.substr(output.size() - 5) == ".grid")
+        {
+            auto writer = Binary(output, options.Width, options.Height, src, dst);
+
+            ok = Generate(options, seed, writer);
+        }
+        else
+        {
+            auto file = output.empty() ? stdout : std::fopen(output.c_str(), "wb");
 
-	int height = 15;
-	int width = height;
+            if (file == nullptr)
+            {
+                std::cerr << "Cannot write " << output << std::endl;
 
-	if(argc > 1){
-		height = atoi(argv[1]);
-		width = height;
-	}
-	if(argc > 2){
-		width = atoi(argv[2]);
-	}
+                return 1;
+            }
 
-	const int H = height*2+1; // array height
-	const int W = width*2+1;  // array width
+            auto writer = Text(file, options.Width, src, dst);
 
- 	vector<vector<int>> maze(H, vector<int>(W));
-	vector<Cell> unvisited;
-	vector<Cell> visited;
+            ok = Generate(options, seed, writer);
 
-	init(maze, unvisited);
-	generate(maze, unvisited, visited);
+            if (file != stdout)
+            {
+                ok = std::fclose(file) == 0 && ok;
+            }
+        }
 
-	Cell start = {1, H-1};
-	Cell finish = {W-1, 1};
-	maze[start.y][start.x] = S;
-	maze[finish.y][finish.x] = P;
+        if (!ok)
+        {
+            std::cerr << "Cannot write " << (output.empty() ? "the maze" : output) << std::endl;
 
-	print(maze);
+            return 1;
+        }
+    }
 
-	return 0;
+    return 0;
 }
@@ -0,0 +1,420 @@
+#ifndef __MAZE_HPP__
+#define __MAZE_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+// Maze generators shared by maze.exe and the benchmark (see maze.cpp for the algorithms).
+//
+// A maze of width by height cells is made a row of cells at a time and handed to a writer, whose
+// Row(y, cells) gets the Flags of each cell of row y and returns false if the row could not be written.
+namespace Maze
+{
+    // Ways out of a cell: to the cell on its right (East) and the one below it (South). Visited marks the
+    // cells backtrack has reached.
+    enum Flags : std::uint8_t
+    {
+        East = 1,
+        South = 2,
+        Visited = 4
+    };
+
+    // Small random number generator (xorshift64*). Only fixed-width integer arithmetic is used (no rand() or
+    // standard distributions, whose results differ between libraries), so its numbers are the same everywhere.
+    class Random
+    {
+    public:
+        Random(std::uint64_t seed)
+        {
+            State = seed * 0x9E3779B97F4A7C15ull + 1;
+        }
+
+        std::uint64_t Next()
+        {
+            State ^= State >> 12;
+
+            State ^= State << 25;
+
+            State ^= State >> 27;
+
+            return State * 0x2545F4914F6CDD1Dull;
+        }
+
+        // Random number from 0 to n - 1
+        int Below(int n)
+        {
+            return Next() % n;
+        }
+
+        bool Flip()
+        {
+            return Next() >> 63;
+        }
+
+    private:
+        std::uint64_t State;
+    };
+
+    // Root of the set of i, halving the paths on the way
+    inline int Find(std::vector<int> &parent, int i)
+    {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+
+            i = parent[i];
+        }
+
+        return i;
+    }
+
+    // Depth-first search from the last cell, joining each cell to a random neighbor it has not reached yet
+    // and going back along its path when there is none
+    template <typename W>
+    bool Backtrack(int width, int height, Random &random, W &writer)
+    {
+        auto cells = std::vector<std::uint8_t>((std::size_t)width * height, 0);
+
+        auto stack = std::vector<int>({width * height - 1});
+
+        cells[stack.back()] = Visited;
+
+        while (!stack.empty())
+        {
+            auto cell = stack.back();
+
+            auto x = cell % width;
+
+            int options[4];
+
+            auto count = 0;
+
+            if (x > 0 && !(cells[cell - 1] & Visited))
+            {
+                options[count++] = cell - 1;
+            }
+
+            if (x < width - 1 && !(cells[cell + 1] & Visited))
+            {
+                options[count++] = cell + 1;
+            }
+
+            if (cell >= width && !(cells[cell - width] & Visited))
+            {
+                options[count++] = cell - width;
+            }
+
+            if (cell < width * (height - 1) && !(cells[cell + width] & Visited))
+            {
+                options[count++] = cell + width;
+            }
+
+            if (count == 0)
+            {
+                stack.pop_back();
+
+                continue;
+            }
+
+            auto next = options[random.Below(count)];
+
+            // Ways out are kept by the cell on the left or above
+            auto first = std::min(cell, next);
+
+            cells[first] |= std::abs(next - cell) == 1 ? East : South;
+
+            cells[next] |= Visited;
+
+            stack.push_back(next);
+        }
+
+        for (auto y = 0; y < height; y++)
+        {
+            if (!writer.Row(y, &cells[(std::size_t)y * width]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Eller's algorithm: cells of a row that are joined (through the rows above) belong to the same set.
+    // Neighbors of different sets are joined at random, then every set goes down to the next row from at
+    // least one of its cells; cells of the next row that are not reached from above start sets of their own.
+    // On the last row every pair of neighbors of different sets is joined, so the maze ends up in one piece.
+    template <typename W>
+    bool Eller(int width, int height, Random &random, W &writer)
+    {
+        // Set of each cell of the row (-1 if none yet). Sets are numbered afresh from 0 on every row, so
+        // there are never more than width of them.
+        auto sets = std::vector<int>(width, -1);
+
+        // Sets joined on the current row
+        auto parent = std::vector<int>(width);
+
+        // For each set: the cells seen, the cell picked to go down if none does at random, whether it goes
+        // down and its number on the next row
+        auto seen = std::vector<int>(width);
+
+        auto picked = std::vector<int>(width);
+
+        auto down = std::vector<bool>(width);
+
+        auto renamed = std::vector<int>(width);
+
+        auto row = std::vector<std::uint8_t>(width);
+
+        auto used = 0;
+
+        for (auto y = 0; y < height; y++)
+        {
+            auto last = y == height - 1;
+
+            std::fill(row.begin(), row.end(), 0);
+
+            for (auto x = 0; x < width; x++)
+            {
+                if (sets[x] < 0)
+                {
+                    sets[x] = used++;
+                }
+            }
+
+            std::iota(parent.begin(), parent.begin() + used, 0);
+
+            for (auto x = 0; x < width - 1; x++)
+            {
+                auto a = Find(parent, sets[x]);
+
+                auto b = Find(parent, sets[x + 1]);
+
+                if (a != b && (last || random.Flip()))
+                {
+                    parent[a] = b;
+
+                    row[x] |= East;
+                }
+            }
+
+            if (!last)
+            {
+                std::fill(seen.begin(), seen.begin() + used, 0);
+
+                std::fill(down.begin(), down.begin() + used, false);
+
+                for (auto x = 0; x < width; x++)
+                {
+                    auto set = Find(parent, sets[x]);
+
+                    sets[x] = set;
+
+                    // Pick one of the cells of the set with equal chances, without knowing how many there are
+                    if (random.Below(++seen[set]) == 0)
+                    {
+                        picked[set] = x;
+                    }
+
+                    if (random.Flip())
+                    {
+                        row[x] |= South;
+
+                        down[set] = true;
+                    }
+                }
+
+                for (auto x = 0; x < width; x++)
+                {
+                    if (!down[sets[x]])
+                    {
+                        row[picked[sets[x]]] |= South;
+
+                        down[sets[x]] = true;
+                    }
+                }
+
+                std::fill(renamed.begin(), renamed.begin() + used, -1);
+
+                used = 0;
+
+                for (auto x = 0; x < width; x++)
+                {
+                    if (row[x] & South)
+                    {
+                        if (renamed[sets[x]] < 0)
+                        {
+                            renamed[sets[x]] = used++;
+                        }
+
+                        sets[x] = renamed[sets[x]];
+                    }
+                    else
+                    {
+                        sets[x] = -1;
+                    }
+                }
+            }
+
+            if (!writer.Row(y, row.data()))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Kruskal's algorithm on the given pairs of neighbors (each the cell on the left or above, times 2, plus 1
+    // for the cell below it): in random order, each pair is joined unless its cells are already joined some
+    // other way (parent holds the sets of cells, see Find)
+    inline void Join(std::vector<std::uint8_t> &cells, std::vector<int> &parent, int width, std::vector<int> &pairs, Random &random)
+    {
+        for (auto i = (int)pairs.size() - 1; i > 0; i--)
+        {
+            std::swap(pairs[i], pairs[random.Below(i + 1)]);
+        }
+
+        for (auto pair : pairs)
+        {
+            auto a = pair / 2;
+
+            auto b = pair & 1 ? a + width : a + 1;
+
+            auto ra = Find(parent, a);
+
+            auto rb = Find(parent, b);
+
+            if (ra != rb)
+            {
+                parent[ra] = rb;
+
+                cells[a] |= pair & 1 ? South : East;
+            }
+        }
+    }
+
+    // Kruskal's algorithm on the rows of a strip from top to bottom, but for its rows next to another strip
+    // (see Kruskal)
+    inline void Strip(std::vector<std::uint8_t> &cells, std::vector<int> &parent, int width, int height, int top, int bottom, Random random)
+    {
+        std::iota(parent.begin() + (std::size_t)top * width, parent.begin() + (std::size_t)bottom * width, top * width);
+
+        auto first = top > 0 ? top + 1 : top;
+
+        auto last = bottom < height ? bottom - 1 : bottom;
+
+        auto pairs = std::vector<int>();
+
+        pairs.reserve((std::size_t)std::max(last - first, 0) * width * 2);
+
+        for (auto y = first; y < last; y++)
+        {
+            for (auto x = 0; x < width; x++)
+            {
+                auto i = y * width + x;
+
+                if (x < width - 1)
+                {
+                    pairs.push_back(i * 2);
+                }
+
+                if (y < last - 1)
+                {
+                    pairs.push_back(i * 2 + 1);
+                }
+            }
+        }
+
+        Join(cells, parent, width, pairs, random);
+    }
+
+    // The maze is cut into strips of rows made by Kruskal's algorithm on threads of their own, all but the
+    // rows on either side of each boundary between strips. Those are left to a last Kruskal's algorithm over
+    // the sets of the whole maze, which joins them to the strips and to each other, so two strips meet
+    // wherever that pass happens to join them (many times along a wide boundary) instead of through a single
+    // passage that every route between them would squeeze through, and every cell can still be reached
+    // from every other by exactly one route. The price is an int per cell for the sets of the whole maze,
+    // and the last pass runs on one thread, though only over 4 rows per boundary. Each strip has its own
+    // random numbers (drawn from random in order), so the maze does not depend on the number of threads.
+    template <typename W>
+    bool Kruskal(int width, int height, int threads, Random &random, W &writer)
+    {
+        const int rows = 64;
+
+        auto cells = std::vector<std::uint8_t>((std::size_t)width * height, 0);
+
+        auto parent = std::vector<int>((std::size_t)width * height);
+
+        auto strips = (height + rows - 1) / rows;
+
+        auto seeds = std::vector<std::uint64_t>(strips);
+
+        for (auto &seed : seeds)
+        {
+            seed = random.Next();
+        }
+
+        auto next = std::atomic<int>(0);
+
+        auto work = [&]()
+        {
+            for (auto i = next++; i < strips; i = next++)
+            {
+                Strip(cells, parent, width, height, i * rows, std::min((i + 1) * rows, height), Random(seeds[i]));
+            }
+        };
+
+        auto pool = std::vector<std::thread>();
+
+        for (auto i = 1; i < std::min(threads, strips); i++)
+        {
+            pool.emplace_back(work);
+        }
+
+        work();
+
+        for (auto &thread : pool)
+        {
+            thread.join();
+        }
+
+        // Pairs with a cell in the last row of a strip (y - 1) or the first row of the next one (y)
+        auto pairs = std::vector<int>();
+
+        for (auto y = rows; y < height; y += rows)
+        {
+            for (auto x = 0; x < width; x++)
+            {
+                for (auto row = y - 2; row <= y && row + 1 < height; row++)
+                {
+                    pairs.push_back((row * width + x) * 2 + 1);
+                }
+
+                if (x < width - 1)
+                {
+                    pairs.push_back(((y - 1) * width + x) * 2);
+
+                    pairs.push_back((y * width + x) * 2);
+                }
+            }
+        }
+
+        Join(cells, parent, width, pairs, random);
+
+        for (auto y = 0; y < height; y++)
+        {
+            if (!writer.Row(y, &cells[(std::size_t)y * width]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+#endif
@@ -0,0 +1,70 @@
+#ifndef __NEAREST_HPP__
+#define __NEAREST_HPP__
+
+#include "astarv2.hpp"
+
+// Path to the nearest of many goals (any exit, any resource tile...) in a single search.
+//
+// Rather than one search per goal, A* runs backwards from all the goals at once (each starts with a cost
+// of 0) until it reaches src. The only tile it heads for is src, so the usual Heuristic guides it, at the
+// same cost per tile whatever the number of goals. The first path to reach src comes from the goal that is
+// cheapest to reach from src, and following the parents back from src walks that path from src to the goal.
+namespace AStar
+{
+    // Backward A* (see FindNearest below) on a grid where steps cost 1 (Straight or Diagonal on 8-connected
+    // grids) or, if Weighted, that cost multiplied by the weight of the tile stepped onto, with what the
+    // search does recorded in stats (see Stats)
+    template <int Connectivity, AStar::Corners Corners, bool Weighted, AStar::Queue Queue, typename S>
+    AStar::Path &Nearest(AStar::Grid &grid, int src, const std::vector<int> &goals, AStar::SearchContext &context, S &stats)
+    {
+        if (src < 0)
+        {
+            stats.Start();
+
+            stats.Stop();
+
+            context.Path.Points.clear();
+
+            return context.Path;
+        }
+
+        auto heuristic = AStar::Heuristic<Connectivity>(grid, src);
+
+        return AStar::Search<Connectivity, Corners, Weighted, Queue, true>(grid, goals.data(), goals.size(), src, context, heuristic, stats);
+    }
+
+    // Same as FindNearest below, with what the search does recorded in stats (see Stats, or NoStats to
+    // record nothing) and the open list kept as Queue says (see FindPath)
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid, AStar::Queue Queue = AStar::Queue::Heap, typename S>
+    AStar::Path &FindNearest(AStar::Grid &grid, int src, const std::vector<int> &goals, AStar::SearchContext &context, S &stats)
+    {
+        static_assert(Connectivity == 4 || Connectivity == 8, "Connectivity must be 4 or 8");
+
+        if (grid.IsWeighted())
+        {
+            return AStar::Nearest<Connectivity, Corners, true, Queue>(grid, src, goals, context, stats);
+        }
+
+        return AStar::Nearest<Connectivity, Corners, false, Queue>(grid, src, goals, context, stats);
+    }
+
+    // Find path from tile src to whichever of the tiles in goals (see Grid::Index) is the cheapest to
+    // reach, as FindPath would find it to that tile. The path ends at the goal that was found.
+    //
+    // The path is kept in the given context and remains valid until its next search
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+    AStar::Path &FindNearest(AStar::Grid &grid, int src, const std::vector<int> &goals, AStar::SearchContext &context)
+    {
+        auto stats = AStar::NoStats();
+
+        return AStar::FindNearest<Connectivity, Corners>(grid, src, goals, context, stats);
+    }
+
+    // Find path from src to the nearest tile marked with goal (see Grid::Locate)
+    template <int Connectivity = 4, AStar::Corners Corners = AStar::Corners::Avoid>
+    AStar::Path &FindNearest(AStar::Grid &grid, const char src, const char goal, AStar::SearchContext &context)
+    {
+        return AStar::FindNearest<Connectivity, Corners>(grid, grid.Find(src), grid.Locate(goal), context);
+    }
+}
+#endif
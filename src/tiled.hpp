@@ -0,0 +1,769 @@
+#ifndef __TILED_HPP__
+#define __TILED_HPP__
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "astarv2.hpp"
+
+// Maps too large to keep in memory, searched straight from a file.
+//
+// The map is cut into square chunks of tiles that are stored one after another in the file (see Write).
+// A Store only keeps the chunks used most recently in memory and reads the others from the file when a
+// search steps onto them, so a search that stays local only ever reads the chunks around its path.
+//
+// A Store numbers and looks up its tiles the same way as a Grid, so AStar::FindPath searches it as it is.
+// The per-tile search state is likewise only kept for the parts of the map a search reaches (see
+// SearchContext).
+namespace AStar
+{
+    namespace Tiled
+    {
+        // Tiles are numbered in blocks of 2^Block by 2^Block tiles (see Store::Index)
+        const int Block = 6;
+
+        // Cost of stepping onto each tile of a map kept in a file, with the most recently used chunks of
+        // tiles cached in memory
+        class Store
+        {
+        public:
+            // Dimensions of the map
+            int Width = 0;
+
+            int Height = 0;
+
+            // Number of tiles along each side of a chunk (a power of two)
+            int ChunkSize = 0;
+
+            // Lowest cost of stepping onto a tile
+            int MinimumWeight = 1;
+
+            // Number of lookups that found their chunk in memory and that had to read it from the file
+            std::uint64_t Hits = 0;
+
+            std::uint64_t Misses = 0;
+
+            // Keep up to capacity chunks in memory
+            Store(int capacity = 64) : Capacity(std::max(capacity, 1))
+            {
+            }
+
+            ~Store()
+            {
+                Close();
+            }
+
+            Store(const Store &) = delete;
+
+            Store &operator=(const Store &) = delete;
+
+            // Open a map written by Write. Returns false (and leaves the store closed) if it is not one.
+            bool Open(const std::string &filename)
+            {
+                Close();
+
+                auto file = open(filename.c_str(), O_RDONLY);
+
+                if (file < 0)
+                {
+                    return false;
+                }
+
+                struct stat status;
+
+                auto header = Header();
+
+                auto length = fstat(file, &status) == 0 ? (std::size_t)status.st_size : 0;
+
+                if (length < sizeof(Header) || pread(file, &header, sizeof(Header), 0) != sizeof(Header) || !Valid(header, length))
+                {
+                    close(file);
+
+                    return false;
+                }
+
+                auto area = (std::size_t)header.Size * header.Size;
+
+                auto chunks = (std::size_t)Count(header.Width, header.Size) * Count(header.Height, header.Size);
+
+                Markers.assign(header.Markers * 3, 0);
+
+                auto bytes = (ssize_t)(Markers.size() * sizeof(std::uint32_t));
+
+                if (pread(file, Markers.data(), bytes, sizeof(Header) + chunks * area) != bytes)
+                {
+                    close(file);
+
+                    Markers.clear();
+
+                    return false;
+                }
+
+                // Markers are turned into tiles without another check (see Find), so they must be on the map
+                for (auto i = 0; i < (int)Markers.size(); i += 3)
+                {
+                    if (Markers[i + 1] >= header.Width || Markers[i + 2] >= header.Height)
+                    {
+                        close(file);
+
+                        Markers.clear();
+
+                        return false;
+                    }
+                }
+
+                File = file;
+
+                Width = header.Width;
+
+                Height = header.Height;
+
+                ChunkSize = header.Size;
+
+                MinimumWeight = header.MinimumWeight;
+
+                Weighted = header.Weighted;
+
+                Shift = 0;
+
+                while ((1 << Shift) < ChunkSize)
+                {
+                    Shift++;
+                }
+
+                Area = area;
+
+                Across = Count(Width, ChunkSize);
+
+                Wide = Log(Count(Width + 2, 1 << AStar::Tiled::Block));
+
+                Tiles = Count(Height + 2, 1 << AStar::Tiled::Block) << (Wide + 2 * AStar::Tiled::Block);
+
+                Slots.assign(chunks, -1);
+
+                Entries.assign(Capacity, Entry());
+
+                Memory.assign(Capacity * Area, 0);
+
+                Used = 0;
+
+                Head = -1;
+
+                Tail = -1;
+
+                Hits = 0;
+
+                Misses = 0;
+
+                return true;
+            }
+
+            // Check if steps may cost more than 1
+            bool IsWeighted()
+            {
+                return Weighted;
+            }
+
+            // Check if tile is on the map
+            bool Contains(int x, int y)
+            {
+                return x >= 0 && x < Width && y >= 0 && y < Height;
+            }
+
+            // Cost of stepping onto the tile at (x, y) (0 if it cannot be traversed or is not on the map)
+            int Cost(int x, int y)
+            {
+                if (!Contains(x, y))
+                {
+                    return 0;
+                }
+
+                auto chunk = Fetch((y >> Shift) * Across + (x >> Shift));
+
+                return chunk[((y & (ChunkSize - 1)) << Shift) + (x & (ChunkSize - 1))];
+            }
+
+            // Number of tiles (with the border and padding, see Index)
+            int Size()
+            {
+                return Tiles;
+            }
+
+            // Index of the tile at (x, y). As in Grid, the map has a border of tiles that cannot be traversed
+            // (so that tiles next to those of the map have an index too), but tiles are numbered a block at a
+            // time so that the tiles around any tile are close to it in search state (see Sparse). Rows of
+            // blocks are padded to a power of two blocks, so coordinates are found with shifts alone.
+            int Index(int x, int y)
+            {
+                auto mask = (1 << AStar::Tiled::Block) - 1;
+
+                x++;
+
+                y++;
+
+                auto block = ((y >> AStar::Tiled::Block) << Wide) + (x >> AStar::Tiled::Block);
+
+                return (block << (2 * AStar::Tiled::Block)) + ((y & mask) << AStar::Tiled::Block) + (x & mask);
+            }
+
+            // Coordinates of a tile
+            int X(int id)
+            {
+                auto mask = (1 << AStar::Tiled::Block) - 1;
+
+                return (((id >> (2 * AStar::Tiled::Block)) & ((1 << Wide) - 1)) << AStar::Tiled::Block) + (id & mask) - 1;
+            }
+
+            int Y(int id)
+            {
+                auto mask = (1 << AStar::Tiled::Block) - 1;
+
+                return ((id >> (2 * AStar::Tiled::Block + Wide)) << AStar::Tiled::Block) + ((id >> AStar::Tiled::Block) & mask) - 1;
+            }
+
+            // Tile one step of (dx, dy) away from tile id
+            int Next(int id, int dx, int dy)
+            {
+                auto side = 1 << AStar::Tiled::Block;
+
+                auto block = id >> (2 * AStar::Tiled::Block);
+
+                auto x = (id & (side - 1)) + dx;
+
+                auto y = ((id >> AStar::Tiled::Block) & (side - 1)) + dy;
+
+                // Steps out of a block lead into the next one along
+                if (x < 0 || x >= side)
+                {
+                    block += x < 0 ? -1 : 1;
+
+                    x -= x < 0 ? -side : side;
+                }
+
+                if (y < 0 || y >= side)
+                {
+                    block += y < 0 ? -(1 << Wide) : (1 << Wide);
+
+                    y -= y < 0 ? -side : side;
+                }
+
+                return (block << (2 * AStar::Tiled::Block)) + (y << AStar::Tiled::Block) + x;
+            }
+
+            bool IsPassable(int id)
+            {
+                return Weight(id) > 0;
+            }
+
+            // Cost of stepping onto a tile (0 if it cannot be traversed)
+            int Weight(int id)
+            {
+                return Cost(X(id), Y(id));
+            }
+
+            // Index of the first tile marked with symbol c (-1 if there is none)
+            int Find(const char c)
+            {
+                for (auto i = 0; i < (int)Markers.size(); i += 3)
+                {
+                    if (Markers[i] == (unsigned char)c)
+                    {
+                        return Index(Markers[i + 1], Markers[i + 2]);
+                    }
+                }
+
+                return -1;
+            }
+
+            // Number of chunks in memory
+            int Resident()
+            {
+                return Used;
+            }
+
+            // Write the text map in input (see examples/) to output, in chunks of size by size tiles (a power
+            // of two). The map is read one row of chunks at a time, so only size rows of it are ever in
+            // memory. Tiles marked with one of the symbols can be traversed and their locations are kept
+            // (see Find), as in Grid.
+            static bool Write(const std::string &input, const std::string &output, const AStar::Terrain &terrain, const std::string &symbols, int size = 256)
+            {
+                if (size < 1 || (size & (size - 1)) != 0)
+                {
+                    return false;
+                }
+
+                std::ifstream file(input);
+
+                if (!file)
+                {
+                    return false;
+                }
+
+                // Find the dimensions of the map first, as the chunks are laid out by them
+                auto header = Header();
+
+                std::string row;
+
+                auto width = 0;
+
+                auto height = 0;
+
+                while (std::getline(file, row))
+                {
+                    width = std::max(width, (int)row.length());
+
+                    height++;
+                }
+
+                std::memcpy(header.Magic, "TIL1", 4);
+
+                header.Width = width;
+
+                header.Height = height;
+
+                header.Size = size;
+
+                header.MinimumWeight = std::max(terrain.Minimum(), 1);
+
+                header.Weighted = !terrain.IsUniform();
+
+                file.clear();
+
+                file.seekg(0);
+
+                auto out = std::fopen(output.c_str(), "wb");
+
+                if (out == nullptr)
+                {
+                    return false;
+                }
+
+                std::array<bool, 256> indexed = {};
+
+                for (auto c : symbols)
+                {
+                    indexed[(unsigned char)c] = true;
+                }
+
+                auto markers = std::vector<std::uint32_t>();
+
+                auto rows = std::vector<std::string>(size);
+
+                auto chunk = std::vector<std::uint8_t>((std::size_t)size * size);
+
+                auto ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+
+                for (auto top = 0; top < height && ok; top += size)
+                {
+                    for (auto j = 0; j < size; j++)
+                    {
+                        rows[j].clear();
+
+                        if (top + j < height)
+                        {
+                            std::getline(file, rows[j]);
+                        }
+                    }
+
+                    for (auto left = 0; left < width && ok; left += size)
+                    {
+                        std::fill(chunk.begin(), chunk.end(), 0);
+
+                        for (auto j = 0; j < size; j++)
+                        {
+                            for (auto x = left; x < std::min(left + size, (int)rows[j].length()); x++)
+                            {
+                                auto c = (unsigned char)rows[j][x];
+
+                                if (indexed[c])
+                                {
+                                    markers.insert(markers.end(), {c, (std::uint32_t)x, (std::uint32_t)(top + j)});
+                                }
+
+                                auto cost = terrain.Costs[c];
+
+                                if (cost == 0 && indexed[c])
+                                {
+                                    cost = header.MinimumWeight;
+                                }
+
+                                chunk[j * size + x - left] = cost;
+                            }
+                        }
+
+                        ok = std::fwrite(chunk.data(), 1, chunk.size(), out) == chunk.size();
+                    }
+                }
+
+                // The number of markers is only known now, so the header is written again
+                header.Markers = markers.size() / 3;
+
+                if (!markers.empty())
+                {
+                    ok = ok && std::fwrite(markers.data(), sizeof(std::uint32_t), markers.size(), out) == markers.size();
+                }
+
+                ok = ok && std::fseek(out, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, out) == 1;
+
+                return std::fclose(out) == 0 && ok;
+            }
+
+        private:
+            // Layout of the files written by Write: the header, the chunks (the cost of each of their tiles,
+            // one row after another) one row of chunks after another, then the locations of the symbols
+            // (symbol, x and y)
+            struct Header
+            {
+                char Magic[4];
+
+                std::uint32_t Width;
+
+                std::uint32_t Height;
+
+                std::uint32_t Size;
+
+                std::uint32_t MinimumWeight;
+
+                std::uint32_t Weighted;
+
+                std::uint32_t Markers;
+            };
+
+            // Chunk held by a slot of the cache and its neighbours in the list of slots from the most to the
+            // least recently used
+            struct Entry
+            {
+                int Chunk = -1;
+
+                int Previous = -1;
+
+                int Next = -1;
+            };
+
+            int File = -1;
+
+            bool Weighted = false;
+
+            // Size is 1 << Shift
+            int Shift = 0;
+
+            // Number of tiles in a chunk
+            std::size_t Area = 0;
+
+            // Number of chunks in a row of chunks
+            int Across = 0;
+
+            // Number of blocks of tiles in a row of blocks is 1 << Wide, and number of tiles (see Index)
+            int Wide = 0;
+
+            int Tiles = 0;
+
+            // Symbol, x and y of each marked tile
+            std::vector<std::uint32_t> Markers;
+
+            // Maximum number of chunks in memory
+            int Capacity;
+
+            // Number of slots in use
+            int Used = 0;
+
+            // Slot of each chunk (-1 if it is not in memory)
+            std::vector<int> Slots;
+
+            std::vector<AStar::Tiled::Store::Entry> Entries;
+
+            // Costs of the tiles of the chunk in each slot
+            std::vector<std::uint8_t> Memory;
+
+            // Most and least recently used slots
+            int Head = -1;
+
+            int Tail = -1;
+
+            static int Count(int length, int size)
+            {
+                return (length + size - 1) / size;
+            }
+
+            // Smallest power of two at least n, as a power
+            static int Log(std::uint64_t n)
+            {
+                auto power = 0;
+
+                while ((std::uint64_t(1) << power) < n)
+                {
+                    power++;
+                }
+
+                return power;
+            }
+
+            static bool Valid(const Header &header, std::size_t length)
+            {
+                if (std::memcmp(header.Magic, "TIL1", 4) != 0 || header.Size == 0 || (header.Size & (header.Size - 1)) != 0 || header.Size > 65536)
+                {
+                    return false;
+                }
+
+                if (header.Width > INT_MAX || header.Height > INT_MAX)
+                {
+                    return false;
+                }
+
+                // Tiles are numbered with an int (see Index)
+                auto side = (std::uint64_t)1 << AStar::Tiled::Block;
+
+                if ((std::uint64_t(1) << Log(((std::uint64_t)header.Width + 2 + side - 1) / side)) * (((std::uint64_t)header.Height + 2 + side - 1) / side) * side * side > INT_MAX)
+                {
+                    return false;
+                }
+
+                auto chunks = (std::size_t)Count(header.Width, header.Size) * Count(header.Height, header.Size);
+
+                return length == sizeof(Header) + chunks * header.Size * header.Size + (std::size_t)header.Markers * 3 * sizeof(std::uint32_t);
+            }
+
+            void Close()
+            {
+                if (File >= 0)
+                {
+                    close(File);
+
+                    File = -1;
+                }
+
+                Width = 0;
+
+                Height = 0;
+
+                Wide = 0;
+
+                Tiles = 0;
+
+                Slots.clear();
+
+                Memory.clear();
+
+                Markers.clear();
+            }
+
+            // Costs of the tiles of a chunk, read from the file into the least recently used slot if needed
+            const std::uint8_t *Fetch(int chunk)
+            {
+                auto slot = Slots[chunk];
+
+                if (slot >= 0)
+                {
+                    Hits++;
+
+                    if (slot != Head)
+                    {
+                        Unlink(slot);
+
+                        Link(slot);
+                    }
+
+                    return &Memory[slot * Area];
+                }
+
+                Misses++;
+
+                if (Used < Capacity)
+                {
+                    slot = Used++;
+                }
+                else
+                {
+                    slot = Tail;
+
+                    Unlink(slot);
+
+                    Slots[Entries[slot].Chunk] = -1;
+                }
+
+                Entries[slot].Chunk = chunk;
+
+                Slots[chunk] = slot;
+
+                Link(slot);
+
+                auto memory = &Memory[slot * Area];
+
+                // Open checked the length of the file, so this only fails if the file changes under us
+                if (pread(File, memory, Area, sizeof(Header) + chunk * Area) != (ssize_t)Area)
+                {
+                    std::fill(memory, memory + Area, 0);
+                }
+
+                return memory;
+            }
+
+            // Take slot out of the list
+            void Unlink(int slot)
+            {
+                auto &entry = Entries[slot];
+
+                (entry.Previous >= 0 ? Entries[entry.Previous].Next : Head) = entry.Next;
+
+                (entry.Next >= 0 ? Entries[entry.Next].Previous : Tail) = entry.Previous;
+            }
+
+            // Put slot at the front of the list
+            void Link(int slot)
+            {
+                auto &entry = Entries[slot];
+
+                entry.Previous = -1;
+
+                entry.Next = Head;
+
+                if (Head >= 0)
+                {
+                    Entries[Head].Previous = slot;
+                }
+
+                Head = slot;
+
+                if (Tail < 0)
+                {
+                    Tail = slot;
+                }
+            }
+        };
+
+        // Array of T that only has memory for the pages of 2^(2 * Block) elements in use, i.e. for the blocks
+        // of tiles of a Store (see Store::Index) whose elements are used. Pages used before Recycle are
+        // handed out again as they are, without clearing them; new pages have all their elements set to
+        // the value last given to assign (T() if none).
+        template <typename T>
+        class Paged
+        {
+        public:
+            Paged()
+            {
+            }
+
+            T &operator[](std::size_t i)
+            {
+                auto &page = Table[i >> (2 * AStar::Tiled::Block)];
+
+                if (page == nullptr)
+                {
+                    page = Take(i >> (2 * AStar::Tiled::Block));
+                }
+
+                return page[i & (Length - 1)];
+            }
+
+            std::size_t size() const
+            {
+                return Count;
+            }
+
+            void resize(std::size_t count)
+            {
+                Table.resize((count + Length - 1) / Length, nullptr);
+
+                Count = count;
+            }
+
+            // Let go of every page, so every element is value from now on
+            void assign(std::size_t count, const T &value)
+            {
+                Table.assign((count + Length - 1) / Length, nullptr);
+
+                Used.clear();
+
+                Free.clear();
+
+                Pages.clear();
+
+                Count = count;
+
+                Fill = value;
+            }
+
+            // Keep the pages in use for the pages used next
+            void Recycle()
+            {
+                for (auto page : Used)
+                {
+                    Free.push_back(Table[page]);
+
+                    Table[page] = nullptr;
+                }
+
+                Used.clear();
+            }
+
+            // Number of pages in use
+            int Reached()
+            {
+                return Used.size();
+            }
+
+        private:
+            static const std::size_t Length = std::size_t(1) << (2 * AStar::Tiled::Block);
+
+            std::size_t Count = 0;
+
+            T Fill = T();
+
+            // Memory of each page (nullptr if it has none) and the pages that have some
+            std::vector<T *> Table;
+
+            std::vector<std::size_t> Used;
+
+            // Memory of pages no longer in use
+            std::vector<T *> Free;
+
+            std::vector<std::unique_ptr<T[]>> Pages;
+
+            T *Take(std::size_t page)
+            {
+                Used.push_back(page);
+
+                if (!Free.empty())
+                {
+                    auto memory = Free.back();
+
+                    Free.pop_back();
+
+                    return memory;
+                }
+
+                Pages.emplace_back(new T[Length]);
+
+                std::fill_n(Pages.back().get(), Length, Fill);
+
+                return Pages.back().get();
+            }
+        };
+
+        // Storage of the per-tile state of a search on a Store (see BasicSearchContext): only the blocks of
+        // tiles the search reaches have memory, and the memory of the last search is reused by the next one,
+        // so a search costs memory for the blocks it reaches rather than for the whole map
+        class Sparse
+        {
+        public:
+            template <typename T>
+            using Array = AStar::Tiled::Paged<T>;
+
+            template <typename T>
+            static void Recycle(AStar::Tiled::Paged<T> &array)
+            {
+                array.Recycle();
+            }
+        };
+
+        // Scratch buffers used by searches on a Store (see AStar::FindPath)
+        typedef AStar::BasicSearchContext<AStar::Tiled::Sparse> SearchContext;
+    }
+}
+#endif
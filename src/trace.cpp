@@ -0,0 +1,238 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+// Draws where A* searched on a map: the tiles it expanded going from A to B, in the order they were expanded
+//
+// Usage: trace.exe map.txt [--load steps.trace] [output...]
+//
+// Without outputs, the map is printed with each tile expanded marked by the tenth of the search it was
+// expanded in ('0' first, '9' last) and the path marked with '*'. Outputs are chosen by extension:
+//   .csv    the steps as CSV (order, x, y, g, h)
+//   .trace  the steps in binary, to be read back with --load
+//   .ppm    heatmap image: walls black, tiles not expanded white, tiles expanded from blue (first) to red
+//           (last), path green
+
+// Helper function to print map
+void Print(std::vector<std::string> &map)
+{
+    for (auto i = 0; i < (int)map.size(); i++)
+    {
+        std::cout << map[i] << std::endl;
+    }
+}
+
+// Helper function to check the extension of a filename
+bool Ends(const std::string &filename, const std::string &extension)
+{
+    return filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// Helper function to draw the steps over the map as a binary PPM image, one pixel per tile
+bool Draw(const std::string &filename, std::vector<std::string> &map, const char passable, AStar::Trace &trace, AStar::Path &path)
+{
+    auto height = (int)map.size();
+
+    auto width = 0;
+
+    for (auto &row : map)
+    {
+        width = std::max(width, (int)row.length());
+    }
+
+    // Walls are black and everything else white, until drawn over
+    auto pixels = std::vector<unsigned char>((std::size_t)width * height * 3, 0);
+
+    for (auto y = 0; y < height; y++)
+    {
+        for (auto x = 0; x < (int)map[y].length(); x++)
+        {
+            if (map[y][x] == passable || map[y][x] == 'A' || map[y][x] == 'B')
+            {
+                std::fill_n(&pixels[((std::size_t)y * width + x) * 3], 3, 255);
+            }
+        }
+    }
+
+    auto count = std::max((int)trace.Steps.size() - 1, 1);
+
+    for (auto i = 0; i < (int)trace.Steps.size(); i++)
+    {
+        auto &step = trace.Steps[i];
+
+        if (step.X >= 0 && step.X < width && step.Y >= 0 && step.Y < height)
+        {
+            auto pixel = &pixels[((std::size_t)step.Y * width + step.X) * 3];
+
+            pixel[0] = 255 * i / count;
+
+            pixel[1] = 0;
+
+            pixel[2] = 255 - pixel[0];
+        }
+    }
+
+    for (auto &point : path.Points)
+    {
+        auto pixel = &pixels[((std::size_t)point.Y * width + point.X) * 3];
+
+        pixel[0] = 0;
+
+        pixel[1] = 255;
+
+        pixel[2] = 0;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+
+    file << "P6\n"
+         << width << " " << height << "\n255\n";
+
+    file.write((const char *)pixels.data(), pixels.size());
+
+    return (bool)file;
+}
+
+int main(int argc, char **argv)
+{
+    const char src = 'A';
+    const char dst = 'B';
+    const char passable = ' ';
+    const char mark = '*';
+
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " map.txt [--load steps.trace] [output.csv|output.trace|output.ppm...]" << std::endl;
+
+        return 1;
+    }
+
+    // Read map from a file
+    auto map = std::vector<std::string>();
+
+    std::string str;
+
+    std::ifstream file(argv[1]);
+
+    while (std::getline(file, str))
+    {
+        map.push_back(str);
+    }
+
+    if (map.empty())
+    {
+        std::cout << "Cannot read " << argv[1] << std::endl;
+
+        return 1;
+    }
+
+    auto grid = AStar::Grid(map, passable, std::string({src, dst}));
+
+    auto context = AStar::SearchContext();
+
+    auto trace = AStar::Trace();
+
+    auto &path = AStar::FindPath(grid, src, dst, context, trace);
+
+    auto outputs = std::vector<std::string>();
+
+    for (auto i = 2; i < argc; i++)
+    {
+        auto arg = std::string(argv[i]);
+
+        if (arg == "--load" && i + 1 < argc)
+        {
+            // Show the steps of an earlier search instead (the path is still the one found on this map)
+            if (!trace.Load(argv[++i]))
+            {
+                std::cout << "Cannot read " << argv[i] << std::endl;
+
+                return 1;
+            }
+        }
+        else
+        {
+            outputs.push_back(arg);
+        }
+    }
+
+    std::cout << "Expanded " << trace.Steps.size() << " tiles";
+
+    if (path.Points.size() > 0)
+    {
+        std::cout << ", path from " << src << " to " << dst << " required " << path.Points.size() - 1 << " steps" << std::endl;
+    }
+    else
+    {
+        std::cout << ", no path found!" << std::endl;
+    }
+
+    if (outputs.empty())
+    {
+        auto marked = map;
+
+        trace.Mark(marked);
+
+        path.Mark(marked, mark);
+
+        // Keep src and dst visible
+        for (auto y = 0; y < (int)map.size(); y++)
+        {
+            for (auto x = 0; x < (int)map[y].length(); x++)
+            {
+                if (map[y][x] == src || map[y][x] == dst)
+                {
+                    marked[y][x] = map[y][x];
+                }
+            }
+        }
+
+        std::cout << std::endl;
+
+        Print(marked);
+
+        return 0;
+    }
+
+    for (auto &output : outputs)
+    {
+        auto ok = false;
+
+        if (Ends(output, ".csv"))
+        {
+            std::ofstream stream(output);
+
+            trace.Write(stream);
+
+            ok = (bool)stream;
+        }
+        else if (Ends(output, ".trace"))
+        {
+            ok = trace.Save(output);
+        }
+        else if (Ends(output, ".ppm"))
+        {
+            ok = Draw(output, map, passable, trace, path);
+        }
+        else
+        {
+            std::cout << "Unknown output " << output << " (expected .csv, .trace or .ppm)" << std::endl;
+
+            return 1;
+        }
+
+        if (!ok)
+        {
+            std::cout << "Cannot write " << output << std::endl;
+
+            return 1;
+        }
+
+        std::cout << "Wrote " << output << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+#include "astarv2.hpp"
+
+// Expansion trace: the order in which a search expanded tiles, with the cost from src (g) and the estimate
+// of the cost to dst (h) of each. Drawing it over the map shows where a heuristic sends the search and
+// which parts of a map make it explore far more than the path needs.
+namespace AStar
+{
+    // Stats that also record every tile expanded (see Stats::Steps), with helpers to write the steps out
+    // and draw them. Pass it to FindPath like Stats; searches without one record nothing (see NoStats).
+    class Trace : public AStar::Stats
+    {
+    public:
+        Trace()
+        {
+            Tracing = true;
+        }
+
+        // Write the steps as CSV: a header, then order, x, y, g and h of each step
+        void Write(std::ostream &stream)
+        {
+            stream << "order,x,y,g,h\n";
+
+            for (auto i = 0; i < (int)Steps.size(); i++)
+            {
+                auto &step = Steps[i];
+
+                stream << i << "," << step.X << "," << step.Y << "," << step.Cost << "," << step.Estimate << "\n";
+            }
+        }
+
+        // Write the steps to a binary file that Load can read back: "TRC1", the number of steps, then the
+        // steps (four 32-bit integers each)
+        bool Save(const std::string &filename)
+        {
+            auto file = std::fopen(filename.c_str(), "wb");
+
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            auto count = (std::uint32_t)Steps.size();
+
+            auto ok = std::fwrite("TRC1", 1, 4, file) == 4 && std::fwrite(&count, sizeof(count), 1, file) == 1;
+
+            // fwrite must not be given the null pointer of an empty vector
+            if (!Steps.empty())
+            {
+                ok = ok && std::fwrite(Steps.data(), sizeof(AStar::Stats::Step), Steps.size(), file) == Steps.size();
+            }
+
+            return std::fclose(file) == 0 && ok;
+        }
+
+        // Read steps written by Save. Returns false (and leaves no steps) if the file is not a trace.
+        bool Load(const std::string &filename)
+        {
+            auto file = std::fopen(filename.c_str(), "rb");
+
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            char magic[4];
+
+            auto count = std::uint32_t(0);
+
+            auto ok = std::fread(magic, 1, 4, file) == 4 && std::memcmp(magic, "TRC1", 4) == 0 && std::fread(&count, sizeof(count), 1, file) == 1;
+
+            // The steps must be all that is left of the file, before memory is set aside for them
+            if (ok)
+            {
+                auto start = std::ftell(file);
+
+                ok = start >= 0 && std::fseek(file, 0, SEEK_END) == 0;
+
+                auto end = ok ? std::ftell(file) : -1;
+
+                ok = ok && end >= start && (std::uint64_t)(end - start) == (std::uint64_t)count * sizeof(AStar::Stats::Step) && std::fseek(file, start, SEEK_SET) == 0;
+            }
+
+            if (ok)
+            {
+                Steps.resize(count);
+
+                ok = std::fread(Steps.data(), sizeof(AStar::Stats::Step), count, file) == count;
+            }
+
+            std::fclose(file);
+
+            if (!ok)
+            {
+                Steps.clear();
+            }
+
+            return ok;
+        }
+
+        // Helper function to mark the steps on map, similar to Path::Mark: each tile expanded shows which
+        // tenth of the search it was expanded in, from '0' (first) to '9' (last)
+        void Mark(std::vector<std::string> &map)
+        {
+            for (auto i = 0; i < (int)Steps.size(); i++)
+            {
+                auto &step = Steps[i];
+
+                if (step.Y >= 0 && step.Y < (int)map.size() && step.X >= 0 && step.X < (int)map[step.Y].length())
+                {
+                    map[step.Y][step.X] = '0' + (long long)i * 10 / Steps.size();
+                }
+            }
+        }
+    };
+}
+#endif